@@ -4,12 +4,18 @@
 
 #include <functional>
 #include <iostream>
+#include <vector>
+
+#include "rng.h"
+#include "sparse.h"
+#include "stats.h"
 
 #define PUBLIC_ID 0
+#define PUBLIC_SLOT 0
 
 class Allocator {
    public:
-    Allocator(uint32_t num_blocks) : num_blocks_(num_blocks) {
+    Allocator(uint32_t num_blocks) : num_blocks_(num_blocks), rng_(random_seed()) {
     }
 
     virtual ~Allocator() = default;
@@ -22,12 +28,30 @@ class Allocator {
 
     virtual void set_demand(uint32_t id, uint32_t demand, bool greedy) = 0;
 
+    // Bulk variants of set_demand() and get_allocation(). Position k refers to
+    // the k-th tenant in the order tenants were added; removing a tenant moves
+    // the most recently added tenant into its position.
+    virtual void set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) = 0;
+
+    virtual void get_allocations(std::vector<uint32_t>& allocations) = 0;
+
     virtual uint32_t get_fair_share() = 0;
 
     virtual uint32_t get_num_tenants() = 0;
 
     virtual uint32_t get_allocation(uint32_t id) = 0;
 
+    // Sparse variants of set_demands() and get_allocations() for quanta where
+    // few tenants are active. Tenants not listed in demands have zero demand
+    // and are not greedy; greedy is indexed by position as in set_demands().
+    // get_sparse_allocations() returns the allocations of the tenants listed
+    // in the last sparse call, in the same order. The defaults go through the
+    // dense calls; overrides cost O(listed tenants) once the allocator is in
+    // sparse mode.
+    virtual void set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy);
+
+    virtual void get_sparse_allocations(SparseRow& allocations);
+
     void set_num_blocks(uint64_t blocks) {
         num_blocks_ = blocks;
     }
@@ -41,6 +65,30 @@ class Allocator {
         return num_blocks_;
     }
 
+    // Counters accumulated across allocate() calls; always empty unless built
+    // with ALLOC_STATS
+    alloc_stats get_stats() {
+        return stats_.to_map();
+    }
+
+    void reset_stats() {
+        stats_.clear();
+    }
+
+    // Restarts the allocator's random stream. Allocators given the same seed
+    // and stream make identical randomized choices; distinct streams are
+    // independent. Unseeded allocators start from a random seed.
+    void seed(uint64_t seed, uint64_t stream = 0) {
+        rng_.seed(seed, stream);
+    }
+
    protected:
     uint64_t num_blocks_;
+    AllocStats stats_;
+    Philox rng_;
+
+    void check_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy);
+
+   private:
+    std::vector<uint32_t> sparse_pos_, sparse_demands_;
 };
\ No newline at end of file
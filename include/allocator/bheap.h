@@ -1,20 +1,34 @@
 #pragma once
 
-#include <functional>
-#include <queue>
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <vector>
 
 typedef std::pair<uint32_t, int32_t> bheap_item;
 
+// Min-heap of (key, value) pairs supporting a constant-time add_all() that
+// shifts every value at once. Stored as a 4-ary implicit heap; clear() keeps
+// the storage so a heap owned by an allocator stops allocating after the
+// first few quanta.
 class BroadcastHeap {
    public:
     BroadcastHeap();
 
+    void reserve(size_t n);
+
+    void clear();
+
     void push(uint32_t key, int32_t val);
 
+    // Bulk insert, re-heapifying in O(N) when the batch outweighs the heap
+    void push_all(const bheap_item* first, const bheap_item* last);
+
     bheap_item pop();
 
+    // Moves every item to out in no particular order and empties the heap
+    void pop_all(std::vector<bheap_item>& out);
+
     int32_t min();
 
     void add_all(int32_t val);
@@ -23,13 +37,28 @@ class BroadcastHeap {
 
     bool empty();
 
+#ifdef ALLOC_STATS
+    // Pushes and pops since the last clear()
+    uint64_t get_pushes();
+
+    uint64_t get_pops();
+#endif
+
    private:
-    struct bheap_cmp {
-        bool operator()(const bheap_item& a, const bheap_item& b) {
-            return a.second > b.second;
-        }
-    };
+    static constexpr size_t ARITY = 4;
+
+    // Ties pop the larger key first so results don't depend on push order
+    static bool before(const bheap_item& a, const bheap_item& b) {
+        return a.second < b.second || (a.second == b.second && a.first > b.first);
+    }
+
+    void sift_up(size_t i);
+
+    void sift_down(size_t i);
 
-    std::priority_queue<bheap_item, std::vector<bheap_item>, bheap_cmp> h_;
+    std::vector<bheap_item> h_;
     int32_t base_val_ = 0;
+#ifdef ALLOC_STATS
+    uint64_t pushes_ = 0, pops_ = 0;
+#endif
 };
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "allocator.h"
+#include "tenant_table.h"
+
+// Lock-free front end that lets any number of threads report demands while a
+// single quantum thread owns the allocator. Each tenant has one atomic word
+// holding its latest (demand, greedy) report, so producers never wait on
+// allocate() or on each other; drain() hands the pending reports to the
+// allocator at the start of a quantum.
+//
+// Tenant IDs map to words through a fixed-capacity open-addressing table that
+// only the quantum thread inserts into. Capacity bounds the number of distinct
+// tenant IDs ever added.
+class DemandInbox {
+   public:
+    DemandInbox(uint32_t capacity);
+
+    // Quantum thread only, never concurrently with drain()
+    void add_tenant(uint32_t id);
+
+    void remove_tenant(uint32_t id);
+
+    // Safe from any thread; the latest report per tenant wins
+    void set_demand(uint32_t id, uint32_t demand, bool greedy);
+
+    // Applies every pending report to alloc and returns how many there were
+    size_t drain(Allocator& alloc);
+
+    // Stable table index of an active tenant, or NO_SLOT. Lock-free, so
+    // readers can key their own per-tenant arrays by it.
+    uint32_t find_slot(uint32_t id) const;
+
+    uint32_t get_table_size() const;
+
+   private:
+    static constexpr uint32_t EMPTY_KEY = UINT32_MAX;
+    static constexpr uint64_t PENDING = 1ull << 63;
+    static constexpr uint64_t GREEDY = 1ull << 32;
+
+    struct Entry {
+        std::atomic<uint32_t> id_{EMPTY_KEY};
+        std::atomic<bool> active_{false};
+        std::atomic<uint64_t> report_{0};
+    };
+
+    uint32_t capacity_, mask_, size_ = 0;
+    std::unique_ptr<Entry[]> entries_;
+
+    uint32_t probe_start(uint32_t id) const;
+
+    Entry* find(uint32_t id) const;
+};
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <limits>
 #include <map>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 #include "allocator.h"
+#include "bheap.h"
+#include "tenant_table.h"
+#include "thread_pool.h"
 
 #define DUMMY_ID std::numeric_limits<uint32_t>::max()
 
-class KarmaAllocator : public Allocator {
+class KarmaAllocator final : public Allocator {
    public:
     KarmaAllocator(uint64_t num_blocks, float alpha, uint32_t init_credits);
 
@@ -22,43 +26,141 @@ class KarmaAllocator : public Allocator {
 
     void set_demand(uint32_t id, uint32_t demand, bool greedy);
 
+    void set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy);
+
     uint32_t get_fair_share();
 
     uint32_t get_num_tenants();
 
     uint32_t get_allocation(uint32_t id);
 
+    void get_allocations(std::vector<uint32_t>& allocations);
+
     uint32_t get_credits(uint32_t id);
 
-   private:
-    struct Tenant {
-        uint32_t demand_ = 0, allocation_ = 0, credits_;
-        int32_t rate_ = 0;
+    // Only slots whose demand changed are touched, so with incremental mode
+    // a quantum costs O(active tenants) apart from the credit accrual
+    void set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy);
 
-        Tenant() : credits_(0) {
-        }
+    void get_sparse_allocations(SparseRow& allocations);
 
-        Tenant(uint32_t init_credits) : credits_(init_credits) {
-        }
-    };
+    void set_incremental(bool incremental);
+
+    // Splits classification, the candidate sorts and the credit update across
+    // num_threads threads once there are enough tenants to pay for it. The
+    // result is identical to running on one thread, the default.
+    void set_num_threads(uint32_t num_threads);
 
+    // Changes the pool size, keeping the public share at alpha
+    void resize(uint64_t num_blocks);
+
+   private:
     struct Candidate {
         int64_t credits_;
-        uint32_t id_, blocks_;
+        uint32_t slot_, blocks_;
 
-        Candidate(uint32_t id, int64_t credits, uint32_t blocks)
-            : id_(id), credits_(credits), blocks_(blocks) {
+        Candidate(uint32_t slot, int64_t credits, uint32_t blocks)
+            : slot_(slot), credits_(credits), blocks_(blocks) {
         }
     };
 
+    // Donor sources for drain_donors(), yielding candidates in ascending
+    // credit order and ending with a DUMMY_ID sentinel
+    struct SortedDonors;
+    struct OrderedDonors;
+
+    // One thread's share of a parallel pass, combined in slot order
+    struct Chunk {
+        std::vector<uint32_t> donors_, borrowers_;
+        uint64_t supply_, demand_, credits_;
+    };
+
+    // Fewest items worth handing to another thread
+    static constexpr size_t PARALLEL_GRAIN = 8192;
+
+    float alpha_;
     uint64_t public_blocks_;
     uint32_t init_credits_;
-    std::unordered_map<uint32_t, Tenant> tenants_;
+    TenantTable tenants_;
+
+    // Credits are stored relative to accrued_, the total per-tenant accrual so
+    // far, so the uniform accrual each quantum is one add. total_credits_ sums
+    // every tenant's actual credits for seeding joins.
+    std::vector<int64_t> credits_;
+    std::vector<int32_t> rates_;
+    int64_t accrued_ = 0;
+    uint64_t total_credits_ = 0;
+
+    // Incremental mode keeps donor/borrower roles and the donor credit order
+    // between quanta, repairing them only for tenants whose demand changed.
+    // Donors are keyed by their relative credits, which the accrual leaves
+    // in order.
+    bool incremental_ = false, stale_ = true;
+    uint32_t role_fair_share_ = 0;
+    uint64_t donor_surplus_ = 0;
+    std::vector<uint32_t> applied_demands_, changed_, borrower_pos_, borrower_list_;
+    std::vector<std::pair<int64_t, uint32_t>> donor_order_, donor_joins_, donor_leaves_;
+
+    // Slots listed by the last sparse call, ascending; every other tenant has
+    // zero demand while sparse_ holds
+    bool sparse_ = false;
+    std::vector<uint32_t> active_, next_active_;
+
+    // Water-filling heap and its batch buffer, reused across quanta
+    BroadcastHeap heap_;
+    std::vector<bheap_item> heap_batch_;
+
+    // Absent when running on one thread
+    std::unique_ptr<ThreadPool> workers_;
+    std::vector<Chunk> chunks_;
 
-    uint32_t get_block_surplus(uint32_t id);
+    uint32_t get_block_surplus(uint32_t slot);
+
+    uint32_t get_slot_credits(uint32_t slot);
+
+    void set_slot_credits(uint32_t slot, uint32_t credits);
+
+    // Adds the slot's rate to its credits and clears the rate
+    void apply_rate(uint32_t slot);
+
+    void apply_rates(const std::vector<uint32_t>& slots);
+
+    // Calls f(chunk, begin, end) on contiguous ranges covering [0, n), on the
+    // workers when n is large enough, and returns the number of ranges
+    template <typename F>
+    size_t for_chunks(size_t n, F f);
+
+    // Sorts each chunk in parallel and merges them pairwise. Equal candidates
+    // may land in any order, which the exchange never observes since the heap
+    // breaks ties by slot.
+    template <typename Compare>
+    void sort_candidates(std::vector<Candidate>& candidates, Compare comp);
+
+    void classify(Chunk& chunk, uint32_t begin, uint32_t end, uint32_t fair_share);
 
     uint64_t get_free_blocks();
 
+    void store_demand(uint32_t slot, uint32_t demand);
+
+    void allocate_incremental();
+
+    void rebuild_roles();
+
+    void update_role(uint32_t slot);
+
+    void join_role(uint32_t slot, uint32_t demand);
+
+    void leave_role(uint32_t slot, uint32_t demand);
+
+    void merge_donor_changes();
+
+    void reorder_drained(size_t drained);
+
+    void lend_to_borrowers(std::vector<uint32_t>& borrowers);
+
+    template <typename Donors>
+    void drain_donors(uint64_t demand, Donors& donors);
+
     void borrow_from_poor(uint64_t demand, std::vector<uint32_t>& donors, std::vector<uint32_t>& borrowers);
 
     void donate_to_rich(uint64_t supply, std::vector<uint32_t>& donors, std::vector<uint32_t>& borrowers);
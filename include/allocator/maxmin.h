@@ -1,10 +1,9 @@
 #pragma once
 
-#include <unordered_map>
-
 #include "allocator.h"
+#include "tenant_table.h"
 
-class MaxMinAllocator : public Allocator {
+class MaxMinAllocator final : public Allocator {
    public:
     MaxMinAllocator(uint64_t num_blocks);
 
@@ -18,16 +17,34 @@ class MaxMinAllocator : public Allocator {
 
     void set_demand(uint32_t id, uint32_t demand, bool greedy);
 
+    void set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy);
+
     uint32_t get_fair_share();
 
     uint32_t get_num_tenants();
 
     uint32_t get_allocation(uint32_t id);
 
+    void get_allocations(std::vector<uint32_t>& allocations);
+
+    void set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy);
+
+    void get_sparse_allocations(SparseRow& allocations);
+
    private:
-    struct Tenant {
-        uint32_t demand_ = 0, allocation_ = 0;
-    };
+    TenantTable tenants_;
+    std::vector<uint32_t> scratch_;
+
+    // In sparse mode only the slots in active_ may have nonzero demands or
+    // allocations, and allocate() visits only those. Any other demand update
+    // or membership change leaves sparse mode.
+    bool sparse_ = false;
+    std::vector<uint32_t> active_;
+
+    void allocate_sparse();
+
+    // Level over the demands in scratch_
+    uint32_t get_water_level();
 
-    std::unordered_map<uint32_t, Tenant> tenants_;
+    void distribute_remainder(uint64_t remainder, uint32_t level);
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "allocator.h"
+#include "tenant_table.h"
 #include "types.h"
 
 struct Bid {
@@ -16,7 +17,7 @@ struct Bid {
     }
 };
 
-class MPSPAllocator : public Allocator {
+class MPSPAllocator final : public Allocator {
    public:
     MPSPAllocator(uint64_t num_blocks, uint64_t base_blocks, fi valuation);
 
@@ -30,39 +31,44 @@ class MPSPAllocator : public Allocator {
 
     void set_demand(uint32_t id, uint32_t demand, bool greedy);
 
+    void set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy);
+
     uint32_t get_fair_share();
 
     uint32_t get_num_tenants();
 
     uint32_t get_allocation(uint32_t id);
 
+    void get_allocations(std::vector<uint32_t>& allocations);
+
     uint32_t get_payment(uint32_t id);
 
+    // Bulk get_payment() in get_allocations() order
+    void get_payments(std::vector<uint32_t>& payments);
+
     fi get_valuation();
 
     pi get_border_bids();
 
    private:
-    struct Tenant {
-        Bid bid_;
-        uint32_t allocation_ = 0, payment_ = 0;
-        fi valuation_;
-
-        Tenant() {
-        }
-
-        Tenant(fi valuation) : valuation_(valuation) {
-        }
-
-        void bid_auction(uint32_t demand, uint32_t fair_share, bool greedy, pi border_bids);
-    };
-
     uint64_t base_blocks_;
     pi border_bids_;
     fi valuation_;
-    std::unordered_map<uint32_t, Tenant> tenants_;
+    TenantTable tenants_;
+    std::vector<Bid> bids_;
+    std::vector<uint32_t> payments_;
+
+    // Remaining bid book from the highest bid down: cumulative quantity and
+    // cumulative welfare, reused across quanta
+    std::vector<uint64_t> book_qty_, book_welfare_;
 
     uint64_t get_free_blocks();
 
-    void charge_exclusion_payment(int id, std::vector<pi>& remaining_bids, uint64_t welfare);
+    void bid_auction(uint32_t slot, uint32_t demand, uint32_t fair_share, bool greedy);
+
+    void build_bid_book(const std::vector<pi>& remaining_bids);
+
+    uint64_t get_exclusion_welfare(const std::vector<pi>& remaining_bids, size_t skip, uint32_t blocks);
+
+    void charge_exclusion_payments(const std::vector<pi>& remaining_bids);
 };
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "allocator.h"
+#include "thread_pool.h"
+
+// Owns one allocator per block pool and runs every pool's allocate() for a
+// quantum on a shared work-stealing thread pool. Pools are independent, so
+// tenant and demand calls are tagged by pool ID and forwarded as-is.
+class PoolManager {
+   public:
+    PoolManager(uint32_t num_threads = std::thread::hardware_concurrency());
+
+    uint32_t add_pool(std::unique_ptr<Allocator> alloc);
+
+    template <typename T, typename... Args>
+    uint32_t emplace_pool(Args&&... args) {
+        return add_pool(std::make_unique<T>(std::forward<Args>(args)...));
+    }
+
+    Allocator& get_pool(uint32_t pool);
+
+    uint32_t get_num_pools();
+
+    uint32_t get_num_threads();
+
+    void add_tenant(uint32_t pool, uint32_t id);
+
+    void remove_tenant(uint32_t pool, uint32_t id);
+
+    void set_demand(uint32_t pool, uint32_t id, uint32_t demand, bool greedy);
+
+    void set_demands(uint32_t pool, const std::vector<uint32_t>& demands, const std::vector<bool>& greedy);
+
+    void allocate();
+
+    uint32_t get_allocation(uint32_t pool, uint32_t id);
+
+    void get_allocations(uint32_t pool, std::vector<uint32_t>& allocations);
+
+   private:
+    std::vector<std::unique_ptr<Allocator>> pools_;
+    ThreadPool workers_;
+    std::function<void(size_t)> allocate_pool_;
+};
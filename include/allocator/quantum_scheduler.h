@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "allocator.h"
+#include "demand_inbox.h"
+
+// Runs an allocator as a live service: a background thread drains reported
+// demands and calls allocate() once per quantum, then publishes the
+// allocations into one of two buffers guarded by a seqlock. Readers never
+// take a lock or wait on allocate(); a read only retries if it stalls for
+// a whole quantum while the writer reuses its buffer.
+//
+// Both buffers are indexed by the inbox's stable table slot, so a read by
+// tenant ID needs no access to the allocator's own tenant table.
+class QuantumScheduler {
+   public:
+    QuantumScheduler(Allocator& alloc, uint32_t capacity, std::chrono::microseconds quantum);
+
+    ~QuantumScheduler();
+
+    void start();
+
+    void stop();
+
+    // Membership changes wait for any running quantum. A new tenant reads an
+    // allocation of 0 until the next quantum is published.
+    void add_tenant(uint32_t id);
+
+    void remove_tenant(uint32_t id);
+
+    // Safe from any thread; applied at the start of the next quantum
+    void set_demand(uint32_t id, uint32_t demand, bool greedy);
+
+    // Drains, allocates and publishes one quantum on the calling thread
+    void run_quantum();
+
+    uint32_t get_allocation(uint32_t id) const;
+
+    // Reads all of ids from the same quantum and returns that quantum's number
+    uint64_t get_allocations(const std::vector<uint32_t>& ids, std::vector<uint32_t>& allocations) const;
+
+    // As above, but unknown tenants read as NO_SLOT instead of throwing
+    uint64_t get_allocations(const uint32_t* ids, size_t count, uint32_t* allocations) const;
+
+    uint64_t get_num_quanta() const;
+
+    // Quanta whose allocate() took longer than the period, so ticks were skipped
+    uint64_t get_num_overruns() const;
+
+   private:
+    Allocator& alloc_;
+    DemandInbox inbox_;
+    std::chrono::microseconds quantum_;
+
+    // Held while a quantum runs or membership changes
+    std::mutex alloc_mutex_;
+    // Inbox slot of each allocator position, and the reverse
+    std::vector<uint32_t> positions_, position_of_;
+    std::vector<uint32_t> allocations_;
+
+    std::unique_ptr<std::atomic<uint32_t>[]> buffers_[2];
+    // Quantum last published, whose buffer is published_ & 1, and quantum
+    // currently being written
+    std::atomic<uint64_t> published_{0}, writing_{0};
+
+    std::thread timer_;
+    std::mutex timer_mutex_;
+    std::condition_variable timer_cv_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> overruns_{0};
+
+    void run_timer();
+
+    void publish();
+
+    template <typename F>
+    uint64_t read_snapshot(F&& read) const;
+};
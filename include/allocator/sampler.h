@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "rng.h"
+
+// Weighted sampler over indices [0, N) backed by a binary sum tree. Weight
+// updates are O(log N), and a batch of n draws with replacement is split down
+// the tree with one binomial per visited node, so it costs O(min(n, N) log N)
+// instead of O(n).
+class WeightedSampler {
+   public:
+    WeightedSampler(const std::vector<uint32_t>& weights);
+
+    void set_weight(uint32_t idx, uint32_t weight);
+
+    uint64_t get_total_weight();
+
+    void sample(Philox& rng, uint64_t n, std::vector<uint32_t>& counts, std::vector<uint32_t>& hits);
+
+   private:
+    size_t leaves_;
+    std::vector<uint64_t> tree_;
+};
@@ -2,15 +2,18 @@
 
 #include "allocator.h"
 #include "maxmin.h"
+#include "tenant_table.h"
 
+// Unredeemed tickets granted in one quantum, lost at the end of quantum expiry_
 struct Claim {
-    uint32_t blocks_, term_;
+    uint32_t blocks_;
+    uint64_t expiry_;
 
-    Claim(uint32_t blocks, uint32_t term) : blocks_(blocks), term_(term) {
+    Claim(uint32_t blocks, uint64_t expiry) : blocks_(blocks), expiry_(expiry) {
     }
 };
 
-class SharpAllocator : public Allocator {
+class SharpAllocator final : public Allocator {
    public:
     SharpAllocator(uint64_t num_blocks, float OD, uint32_t tau);
 
@@ -24,26 +27,27 @@ class SharpAllocator : public Allocator {
 
     void set_demand(uint32_t id, uint32_t demand, bool greedy);
 
+    void set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy);
+
     uint32_t get_fair_share();
 
     uint32_t get_num_tenants();
 
     uint32_t get_allocation(uint32_t id);
 
+    void get_allocations(std::vector<uint32_t>& allocations);
+
     uint32_t get_tickets(uint32_t id);
 
+    // Bulk get_tickets() in get_allocations() order
+    void get_tickets(std::vector<uint32_t>& tickets);
+
     uint64_t get_available_tickets();
 
    private:
-    struct Tenant {
-        uint32_t num_tickets_ = 0;
-        std::vector<Claim> claims_;
-        uint32_t demand_ = 0, allocation_ = 0;
-
-        void grant_claim(Claim claim);
+    void grant_claim(uint32_t slot, uint32_t blocks);
 
-        uint32_t expire_claims();
-    };
+    uint32_t expire_claims(uint32_t slot);
 
     void delegate_claims();
 
@@ -53,5 +57,14 @@ class SharpAllocator : public Allocator {
 
     MaxMinAllocator claim_alloc_;
     uint32_t claim_term_;
-    std::unordered_map<uint32_t, Tenant> tenants_;
+    TenantTable tenants_;
+    std::vector<uint32_t> tickets_;
+
+    // Every claim has the same term, so each slot's claims expire in the order
+    // they were granted and at most one expires per quantum. Claims are kept
+    // oldest first from claim_head_, so redemption and expiry only touch the
+    // claims they consume; the consumed prefix is dropped once it dominates.
+    uint64_t quantum_ = 0;
+    std::vector<std::vector<Claim>> claims_;
+    std::vector<uint32_t> claim_head_;
 };
\ No newline at end of file
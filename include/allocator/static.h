@@ -1,10 +1,9 @@
 #pragma once
 
-#include <unordered_map>
-
 #include "allocator.h"
+#include "tenant_table.h"
 
-class StaticAllocator : public Allocator {
+class StaticAllocator final : public Allocator {
    public:
     StaticAllocator(uint64_t num_blocks);
 
@@ -18,12 +17,26 @@ class StaticAllocator : public Allocator {
 
     void set_demand(uint32_t id, uint32_t demand, bool greedy);
 
+    void set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy);
+
     uint32_t get_fair_share();
 
     uint32_t get_num_tenants();
 
     uint32_t get_allocation(uint32_t id);
 
+    void get_allocations(std::vector<uint32_t>& allocations);
+
+    void set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy);
+
+    void get_sparse_allocations(SparseRow& allocations);
+
    private:
-    std::unordered_map<uint32_t, uint32_t> allocations_;
+    TenantTable tenants_;
+
+    // Allocations only change with the fair share, so allocate() refills them
+    // after membership or pool size changes
+    bool stale_ = true;
+    uint32_t filled_share_ = 0;
+    std::vector<uint32_t> listed_;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Per-phase counters recorded inside allocate(), reported keyed
+// "<allocator>.<name>". Only compiled in with -DALLOC_STATS (cmake
+// -DALLOC_STATS=ON); otherwise the STATS_* macros expand to nothing and their
+// arguments are never evaluated.
+typedef std::map<std::string, uint64_t> alloc_stats;
+
+// Phases timed by STATS_PHASE
+enum class StatsPhase : uint8_t {
+    KARMA_CLASSIFY,
+    KARMA_CREDITS,
+    KARMA_SORT,
+    KARMA_EXCHANGE,
+    MAXMIN_LEVEL,
+    MAXMIN_FILL,
+    MPSP_SORT,
+    MPSP_PAYMENTS,
+    SHARP_DELEGATE,
+    SHARP_REDEEM,
+    SHARP_EXPIRE,
+    NUM_PHASES
+};
+
+// Events counted by STATS_ADD
+enum class StatsCounter : uint8_t {
+    KARMA_CHANGED_TENANTS,
+    KARMA_EXCHANGE_ROUNDS,
+    KARMA_HEAP_PUSHES,
+    KARMA_HEAP_POPS,
+    MAXMIN_LEVEL_ROUNDS,
+    MPSP_WINNING_BIDS,
+    SHARP_LOTTERY_ROUNDS,
+    SHARP_LOTTERY_DRAWS,
+    NUM_COUNTERS
+};
+
+// Fixed arrays indexed by the enums above, so recording is one add; names are
+// only built by to_map()
+struct AllocStats {
+    static constexpr size_t NUM_PHASES = (size_t)StatsPhase::NUM_PHASES;
+    static constexpr size_t NUM_COUNTERS = (size_t)StatsCounter::NUM_COUNTERS;
+
+    uint64_t cycles_[NUM_PHASES] = {}, calls_[NUM_PHASES] = {};
+    uint64_t counters_[NUM_COUNTERS] = {};
+
+    void clear();
+
+    // "<phase>.cycles" and "<phase>.calls" for every phase entered, and every
+    // counter that is nonzero
+    alloc_stats to_map() const;
+};
+
+#ifdef ALLOC_STATS
+
+// Cycle counter where the target has one, nanoseconds otherwise
+uint64_t read_cycles();
+
+// Adds the cycles spent in its scope to the phase and counts the call
+class PhaseTimer {
+   public:
+    PhaseTimer(AllocStats& stats, StatsPhase phase) : stats_(stats), phase_((size_t)phase), start_(read_cycles()) {
+    }
+
+    ~PhaseTimer() {
+        stats_.cycles_[phase_] += read_cycles() - start_;
+        stats_.calls_[phase_]++;
+    }
+
+   private:
+    AllocStats& stats_;
+    size_t phase_;
+    uint64_t start_;
+};
+
+#define STATS_CONCAT_(a, b) a##b
+#define STATS_CONCAT(a, b) STATS_CONCAT_(a, b)
+#define STATS_PHASE(phase) PhaseTimer STATS_CONCAT(phase_timer_, __LINE__)(stats_, StatsPhase::phase)
+#define STATS_ADD(counter, n) (stats_.counters_[(size_t)StatsCounter::counter] += (n))
+
+#else
+
+#define STATS_PHASE(phase) ((void)0)
+#define STATS_ADD(counter, n) ((void)0)
+
+#endif
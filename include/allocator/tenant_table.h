@@ -0,0 +1,50 @@
+#pragma once
+
+#include <assert.h>
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#define NO_SLOT std::numeric_limits<uint32_t>::max()
+
+// Dense tenant store shared by the allocators. External tenant IDs are
+// resolved to a slot once; per-tenant state lives in contiguous columns
+// indexed by slot so that allocate() can run linear scans. Removing a tenant
+// moves the last slot into the freed one, so slots are only stable between
+// membership changes.
+class TenantTable {
+   public:
+    TenantTable();
+
+    uint32_t add(uint32_t id);
+
+    uint32_t remove(uint32_t id);
+
+    uint32_t find(uint32_t id) const;
+
+    bool contains(uint32_t id) const;
+
+    uint32_t size() const;
+
+    uint32_t id(uint32_t slot) const;
+
+    const std::vector<uint32_t>& ids() const;
+
+    std::vector<uint32_t> demands_, allocations_;
+
+   private:
+    std::vector<uint32_t> ids_;
+    std::unordered_map<uint32_t, uint32_t> slots_;
+};
+
+// Mirrors TenantTable::remove() on an allocator-specific column.
+template <typename T>
+void erase_slot(std::vector<T>& column, uint32_t slot) {
+    assert(slot < column.size());
+    if (slot + 1 < column.size()) {
+        column[slot] = std::move(column.back());
+    }
+    column.pop_back();
+}
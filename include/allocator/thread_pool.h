@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run batches of indexed tasks. Each run()
+// deals the task indices round-robin onto per-thread deques; a thread works
+// through its own deque from the back and, once empty, steals from the front
+// of the others. The calling thread takes part as worker 0.
+class ThreadPool {
+   public:
+    ThreadPool(uint32_t num_threads);
+
+    ~ThreadPool();
+
+    uint32_t get_num_threads();
+
+    // Calls task(i) for every i < num_tasks and returns once all have finished
+    void run(size_t num_tasks, const std::function<void(size_t)>& task);
+
+   private:
+    struct TaskQueue {
+        std::mutex m_;
+        std::deque<size_t> tasks_;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex m_;
+    std::condition_variable start_cv_, done_cv_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    uint64_t generation_ = 0;
+    uint32_t active_ = 0;
+    std::atomic<size_t> pending_{0};
+    bool stop_ = false;
+
+    void worker_loop(uint32_t idx);
+
+    void drain(uint32_t idx, const std::function<void(size_t)>& task);
+
+    bool next_task(uint32_t idx, size_t& task);
+};
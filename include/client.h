@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "protocol.h"
+
+// Blocking client for AllocServer. The send_/recv_ pairs let a caller keep
+// several requests in flight on one connection; replies arrive in order.
+class AllocClient {
+   public:
+    AllocClient(const std::string& socket_path);
+
+    ~AllocClient();
+
+    // Each returns the number of records the server rejected
+    uint32_t add_tenants(const std::vector<uint32_t>& ids);
+
+    uint32_t remove_tenants(const std::vector<uint32_t>& ids);
+
+    uint32_t set_demands(const std::vector<DemandUpdate>& updates);
+
+    // Returns the quantum the allocations were read from
+    uint64_t get_allocations(const std::vector<uint32_t>& ids, std::vector<uint32_t>& allocations);
+
+    void send_request(uint32_t type, const void* records, uint32_t count);
+
+    // Reads the reply to an add, remove or set request
+    uint32_t recv_ack();
+
+   private:
+    int fd_;
+
+    void send_all(const void* data, size_t len);
+
+    void recv_all(void* data, size_t len);
+};
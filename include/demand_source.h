@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "rng.h"
+#include "sparse.h"
+#include "trace.h"
+#include "types.h"
+
+// Yields a demand trace one quantum at a time so that a simulation only ever
+// holds the current row
+class DemandSource {
+   public:
+    DemandSource(uint32_t N, uint64_t T) : N_(N), T_(T) {
+    }
+
+    virtual ~DemandSource() = default;
+
+    // Fills demands with the next quantum's N demands; false once T quanta
+    // have been produced
+    virtual bool next(std::vector<uint32_t>& demands) = 0;
+
+    // Sparse form of next() listing the tenants with nonzero demand; the
+    // default compresses the dense row
+    virtual bool next_sparse(SparseRow& demands);
+
+    // Rewinds to the first quantum
+    virtual void reset() = 0;
+
+    uint32_t get_num_tenants() {
+        return N_;
+    }
+
+    uint64_t get_num_quanta() {
+        return T_;
+    }
+
+   protected:
+    uint32_t N_;
+    uint64_t T_, t_ = 0;
+
+   private:
+    std::vector<uint32_t> dense_;
+};
+
+// Whitespace-separated text trace, read as a flat stream of N x T values
+class TextDemandSource : public DemandSource {
+   public:
+    TextDemandSource(const std::string& filename, uint32_t N, uint64_t T);
+
+    bool next(std::vector<uint32_t>& demands);
+
+    void reset();
+
+   private:
+    std::ifstream file_;
+};
+
+// First N tenants of the first T quanta of a mapped binary trace
+class TraceDemandSource : public DemandSource {
+   public:
+    TraceDemandSource(const std::string& filename, uint32_t N, uint64_t T);
+
+    bool next(std::vector<uint32_t>& demands);
+
+    void reset();
+
+   private:
+    DemandTrace trace_;
+};
+
+// First N tenants of the first T quanta of a delta trace, decoded one row
+// at a time
+class DeltaTraceDemandSource : public DemandSource {
+   public:
+    DeltaTraceDemandSource(const std::string& filename, uint32_t N, uint64_t T);
+
+    bool next(std::vector<uint32_t>& demands);
+
+    void reset();
+
+   private:
+    DeltaTrace trace_;
+    DeltaTraceReader reader_;
+};
+
+// Demands drawn uniformly from [0, max_demand] using the given Philox stream;
+// reset() replays the same sequence
+class UniformDemandSource : public DemandSource {
+   public:
+    UniformDemandSource(uint32_t N, uint64_t T, uint32_t max_demand, uint64_t seed, uint64_t stream = 0);
+
+    bool next(std::vector<uint32_t>& demands);
+
+    void reset();
+
+   private:
+    uint64_t seed_, stream_;
+    Philox gen_;
+    std::uniform_int_distribution<uint32_t> dist_;
+};
+
+// Replays an in-memory demand matrix
+class MatrixDemandSource : public DemandSource {
+   public:
+    MatrixDemandSource(const matrix& demands);
+
+    bool next(std::vector<uint32_t>& demands);
+
+    void reset();
+
+   private:
+    const matrix& demands_;
+};
+
+// Picks the binary or text backend from the file contents
+std::unique_ptr<DemandSource> open_demand_source(const std::string& filename, uint32_t N, uint64_t T);
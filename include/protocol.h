@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+// Binary protocol spoken by AllocServer over a Unix domain socket. Every
+// message is a MsgHeader followed by count fixed-size records, all in host
+// byte order since both ends share the machine. Requests on a connection
+// are answered in order, so clients may pipeline them.
+//
+//   request                   records           reply
+//   MSG_ADD_TENANTS           uint32_t id       header, count = rejected
+//   MSG_REMOVE_TENANTS        uint32_t id       header, count = rejected
+//   MSG_SET_DEMANDS           DemandUpdate      header, count = rejected
+//   MSG_GET_ALLOCATIONS       uint32_t id       header, uint64_t quantum,
+//                                               count x uint32_t allocation
+//
+// Unknown tenants read as NO_ALLOCATION. A malformed header closes the
+// connection.
+#define MSG_ADD_TENANTS 1
+#define MSG_REMOVE_TENANTS 2
+#define MSG_SET_DEMANDS 3
+#define MSG_GET_ALLOCATIONS 4
+
+#define MSG_MAX_RECORDS (1u << 20)
+#define NO_ALLOCATION UINT32_MAX
+
+#define DEMAND_GREEDY (1u << 31)
+
+struct MsgHeader {
+    uint32_t type_ = 0, count_ = 0;
+};
+
+// The top bit of demand_ carries the greedy flag
+struct DemandUpdate {
+    uint32_t id_ = 0, demand_ = 0;
+};
+
+// Size of the records following a request header, or 0 for an unknown type
+inline uint32_t record_size(uint32_t type) {
+    switch (type) {
+        case MSG_ADD_TENANTS:
+        case MSG_REMOVE_TENANTS:
+        case MSG_GET_ALLOCATIONS:
+            return sizeof(uint32_t);
+        case MSG_SET_DEMANDS:
+            return sizeof(DemandUpdate);
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Counter-based Philox4x32-10 generator (Salmon et al., SC '11). Block i of
+// stream s under a given seed is a pure function of (seed, s, i), so every
+// allocator, simulation or thread can own an independent stream with no
+// shared state, and a run is reproducible from its seed alone.
+// Satisfies UniformRandomBitGenerator for use with <random> distributions.
+class Philox {
+   public:
+    typedef uint32_t result_type;
+    typedef std::array<uint32_t, 4> counter;
+    typedef std::array<uint32_t, 2> key;
+
+    Philox(uint64_t seed = 0, uint64_t stream = 0);
+
+    void seed(uint64_t seed, uint64_t stream = 0);
+
+    result_type operator()();
+
+    // Skips the next n outputs in O(1)
+    void discard(uint64_t n);
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return UINT32_MAX;
+    }
+
+    // The raw bijection: ten rounds over ctr keyed by k
+    static counter block(counter ctr, key k);
+
+   private:
+    key key_;
+    uint64_t stream_, index_;
+    counter out_;
+    uint32_t pos_;
+
+    void refill();
+};
+
+// Nondeterministic seed for runs that do not ask for one
+uint64_t random_seed();
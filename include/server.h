@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "allocator/quantum_scheduler.h"
+#include "protocol.h"
+
+// Serves a QuantumScheduler over a Unix domain socket using the batched
+// protocol in protocol.h. Each I/O thread runs its own epoll loop; all of
+// them wait on the listening socket and keep the connections they accept.
+// Demand updates go straight to the scheduler's lock-free inbox, and reads
+// come from its published snapshot, so I/O threads never wait on allocate().
+class AllocServer {
+   public:
+    AllocServer(QuantumScheduler& sched, const std::string& socket_path, uint32_t num_threads = 2);
+
+    ~AllocServer();
+
+    void start();
+
+    void stop();
+
+    // Demand updates accepted since start()
+    uint64_t get_num_updates() const;
+
+   private:
+    struct Connection {
+        int fd_;
+        std::vector<uint8_t> in_, out_;
+        size_t in_len_ = 0, out_pos_ = 0;
+        bool blocked_ = false;
+    };
+
+    QuantumScheduler& sched_;
+    std::string path_;
+    uint32_t num_threads_;
+    int listen_fd_ = -1, stop_fd_ = -1;
+    std::vector<int> epoll_fds_, wake_fds_;
+    std::vector<std::thread> threads_;
+    std::atomic<uint64_t> updates_{0};
+
+    // Signals stop_fd_, falling back to a fresh eventfd if the write fails
+    void wake_threads();
+
+    void serve(int epoll_fd);
+
+    void accept_all(int epoll_fd);
+
+    bool on_readable(int epoll_fd, Connection& c);
+
+    bool flush(int epoll_fd, Connection& c);
+
+    bool handle_messages(Connection& c);
+
+    void handle_message(const MsgHeader& header, const uint8_t* records, std::vector<uint8_t>& out);
+};
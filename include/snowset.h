@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+// Bins raw Snowset query records (one CSV row per query, with a header row)
+// into a T x N demand matrix, replacing the pandas pipeline in
+// dataloader.ipynb. The CSV must be uncompressed so that it can be mapped and
+// split into chunks parsed in parallel. A tenant's demand in a quantum is
+// the number of its queries running during that quantum.
+class SnowsetLoader {
+   public:
+    // Tenants are keyed by tenant_column, e.g. warehouseId or databaseId
+    SnowsetLoader(const std::string& filename, const std::string& tenant_column = "warehouseId");
+
+    ~SnowsetLoader();
+
+    SnowsetLoader(const SnowsetLoader&) = delete;
+
+    SnowsetLoader& operator=(const SnowsetLoader&) = delete;
+
+    // Bins the queries created in [start, end) Unix seconds into quanta of
+    // quantum seconds. N tenants are sampled uniformly, as determined by
+    // seed, from those with a query in the window; the matrix has fewer
+    // columns if fewer tenants are active.
+    matrix bin(uint64_t start, uint64_t end, uint32_t quantum, uint32_t N, uint64_t seed, uint32_t num_threads);
+
+    // Streaming form of bin() that passes each quantum's row to emit in
+    // order. Only one row is held, plus two edges per sampled query.
+    void bin(uint64_t start, uint64_t end, uint32_t quantum, uint32_t N, uint64_t seed, uint32_t num_threads,
+             const std::function<void(const std::vector<uint32_t>&)>& emit);
+
+    // Quanta in a bin() over [start, end)
+    static uint64_t get_num_quanta(uint64_t start, uint64_t end, uint32_t quantum);
+
+    // Counts from the last bin(): queries binned, and rows skipped for
+    // nulls or unparsable fields
+    uint64_t get_num_queries();
+
+    uint64_t get_num_skipped();
+
+   private:
+    struct Query {
+        uint64_t tenant_;
+        int64_t created_ms_, duration_ms_;
+    };
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const char *body_ = nullptr, *end_ = nullptr;
+    uint32_t tenant_col_, created_col_, duration_col_, last_col_;
+    uint64_t num_queries_ = 0, num_skipped_ = 0;
+
+    // Splits the body into about n ranges on row boundaries
+    std::vector<std::pair<const char*, const char*>> split(size_t n);
+
+    // Parses the row at p into q and returns the start of the next row;
+    // valid is false for rows that cannot be binned
+    const char* parse_row(const char* p, const char* end, Query& q, bool& valid);
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One quantum of per-tenant values in compressed form: the positions of the
+// listed tenants in increasing order and their values. Positions follow the
+// allocators' bulk order; tenants that are not listed are zero.
+struct SparseRow {
+    std::vector<uint32_t> pos_, val_;
+
+    void clear();
+
+    size_t size() const;
+
+    void push_back(uint32_t pos, uint32_t val);
+
+    // Lists the nonzero entries of dense
+    void assign(const std::vector<uint32_t>& dense);
+
+    void to_dense(uint32_t N, std::vector<uint32_t>& dense) const;
+};
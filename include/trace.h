@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+// Binary demand trace: a fixed header followed by T rows of N demands, each
+// stored little-endian in width bytes (1, 2 or 4), quantum-major
+#define TRACE_MAGIC 0x54445346  // "FSDT"
+#define TRACE_VERSION 1
+
+// Delta trace: the same header under DELTA_TRACE_MAGIC with width 0, an
+// index of one uint64 byte offset per block of block_rows quanta, then the
+// rows. A block's first row stores its demands and later rows the change
+// from the row above, so any block decodes on its own. Each row is a series
+// of LEB128 varint tokens: an odd token 2k + 1 skips k + 1 unchanged tenants
+// and an even token 2z updates one tenant by the zigzag-encoded change z.
+#define DELTA_TRACE_MAGIC 0x56445346  // "FSDV"
+#define DELTA_TRACE_BLOCK_ROWS 256
+
+struct TraceHeader {
+    uint32_t magic_ = TRACE_MAGIC, version_ = TRACE_VERSION;
+    uint32_t width_ = 4, N_ = 0;
+    uint64_t T_ = 0, block_rows_ = 0;
+};
+
+// View of one quantum inside a mapped trace; valid while the trace is open
+class TraceRow {
+   public:
+    TraceRow(const uint8_t* data, uint32_t width, uint32_t N);
+
+    uint32_t operator[](uint32_t i) const;
+
+    uint32_t size() const;
+
+    void copy_to(std::vector<uint32_t>& demands) const;
+
+   private:
+    const uint8_t* data_;
+    uint32_t width_, N_;
+};
+
+// Read-only mmap of a binary trace. Rows are served straight from the page
+// cache, so opening a trace costs the same regardless of its length.
+class DemandTrace {
+   public:
+    DemandTrace(const std::string& filename);
+
+    ~DemandTrace();
+
+    DemandTrace(const DemandTrace&) = delete;
+
+    DemandTrace& operator=(const DemandTrace&) = delete;
+
+    static bool is_trace(const std::string& filename);
+
+    uint32_t get_num_tenants() const;
+
+    uint64_t get_num_quanta() const;
+
+    uint32_t get_width() const;
+
+    TraceRow row(uint64_t t) const;
+
+   private:
+    TraceHeader header_;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const uint8_t* rows_ = nullptr;
+};
+
+// Read-only mmap of a delta trace
+class DeltaTrace {
+   public:
+    DeltaTrace(const std::string& filename);
+
+    ~DeltaTrace();
+
+    DeltaTrace(const DeltaTrace&) = delete;
+
+    DeltaTrace& operator=(const DeltaTrace&) = delete;
+
+    static bool is_delta_trace(const std::string& filename);
+
+    uint32_t get_num_tenants() const;
+
+    uint64_t get_num_quanta() const;
+
+    uint64_t get_block_rows() const;
+
+    // Encoded bytes of the block holding quantum t, as [begin, end)
+    std::pair<const uint8_t*, const uint8_t*> block(uint64_t t) const;
+
+   private:
+    TraceHeader header_;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    const uint64_t* index_ = nullptr;
+    const uint8_t* rows_ = nullptr;
+    size_t rows_size_ = 0;
+};
+
+// Sequential decoder over a delta trace. seek() costs up to one block of
+// decoding; next() is a single pass over the row's bytes.
+class DeltaTraceReader {
+   public:
+    DeltaTraceReader(const DeltaTrace& trace);
+
+    void seek(uint64_t t);
+
+    // Decodes quantum t into demands and advances; false past the last quantum
+    bool next(std::vector<uint32_t>& demands);
+
+   private:
+    const DeltaTrace& trace_;
+    uint64_t t_ = 0;
+    const uint8_t *p_ = nullptr, *end_ = nullptr;
+    std::vector<uint32_t> row_;
+
+    void decode_row(bool delta);
+};
+
+// Encodes a delta trace one quantum at a time, holding only the previous row
+// and the block being filled. T must be known up front because the block
+// index precedes the rows.
+class DeltaTraceWriter {
+   public:
+    DeltaTraceWriter(const std::string& filename, uint32_t N, uint64_t T,
+                     uint64_t block_rows = DELTA_TRACE_BLOCK_ROWS);
+
+    // Encodes the next quantum, writing the block out once it is full
+    void append(const std::vector<uint32_t>& demands);
+
+    // Writes the last block and the index; the file is incomplete until then
+    void close();
+
+   private:
+    std::ofstream out_;
+    TraceHeader header_;
+    uint64_t t_ = 0, offset_ = 0;
+    std::vector<uint64_t> index_;
+    std::vector<uint32_t> prev_;
+    std::vector<uint8_t> block_;
+
+    void flush();
+};
+
+void write_trace(const std::string& filename, matrix& demands);
+
+void write_delta_trace(const std::string& filename, matrix& demands, uint64_t block_rows = DELTA_TRACE_BLOCK_ROWS);
+
+// Streams a whitespace-separated text trace (one quantum per line) into the
+// binary format using the narrowest width that fits its largest demand
+void convert_text_trace(const std::string& text_filename, const std::string& trace_filename);
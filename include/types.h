@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 
 typedef std::pair<uint32_t, uint32_t> pi;
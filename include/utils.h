@@ -1,19 +1,28 @@
+#pragma once
+
 #include <random>
 #include <vector>
 
+#include "rng.h"
+#include "sparse.h"
 #include "types.h"
 
-bool rand_bool();
+// Randomized helpers draw from the caller's stream, so results depend only
+// on how that stream was seeded
+bool rand_bool(Philox& rng);
 
-int rand_uniform(int min, int max);
+int rand_uniform(Philox& rng, int min, int max);
 
 std::discrete_distribution<> get_rand_discrete(std::vector<uint32_t>& weights);
 
-int sample_rand_discrete(std::discrete_distribution<>& dist);
+int sample_rand_discrete(Philox& rng, std::discrete_distribution<>& dist);
+
+// Touches no global state, so separate streams can sample concurrently
+uint64_t sample_rand_binomial(Philox& rng, uint64_t n, double p);
 
-matrix generate_uniform_demands(uint32_t N, uint32_t T, uint32_t max_demand);
+matrix generate_uniform_demands(uint32_t N, uint32_t T, uint32_t max_demand, uint64_t seed);
 
-matrix read_demands(char* filename, uint32_t N, uint32_t T, bool shuffle);
+matrix read_demands(char* filename, uint32_t N, uint32_t T, bool shuffle, uint64_t seed = 0);
 
 std::vector<double> welfares(matrix& demands, matrix& allocations);
 
@@ -29,6 +38,45 @@ double instant_fairness(std::vector<uint32_t>& demands, std::vector<uint32_t>& a
 
 double utilization(matrix& demands, matrix& allocations, uint64_t blocks);
 
+// Streaming form of welfares(), utilization() and the average of
+// instant_fairness(). Each quantum folds into per-tenant totals, so the final
+// metrics cost O(N) and no allocation history is kept. Fairness is taken
+// over tenants si..N-1.
+class MetricAccumulator {
+   public:
+    MetricAccumulator(uint32_t N, size_t si);
+
+    void reset();
+
+    void add_quantum(std::vector<uint32_t>& demands, std::vector<uint32_t>& allocations);
+
+    // Sparse variant; allocations lists the same tenants as demands, and every
+    // other tenant counts as idle
+    void add_quantum(const SparseRow& demands, const SparseRow& allocations);
+
+    // Valued variant used for MPSP, where welfare is weighed by payments
+    void add_quantum(std::vector<uint32_t>& demands, std::vector<uint32_t>& allocations,
+                     std::vector<uint32_t>& payments, fi valuation);
+
+    uint64_t get_num_quanta();
+
+    double get_utilization(uint64_t blocks);
+
+    std::vector<double> get_welfares();
+
+    std::vector<double> get_valued_welfares();
+
+    double get_avg_fairness();
+
+   private:
+    uint32_t N_;
+    size_t si_;
+    uint64_t T_ = 0, total_used_ = 0;
+    double total_fairness_ = 0;
+    std::vector<uint64_t> used_, demanded_;
+    std::vector<double> valued_, expected_;
+};
+
 double range_average(std::vector<double>& arr, size_t a, size_t b);
 
 void clamp(double* a, double* b);
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "allocator/allocator.h"
+
+#include <stdexcept>
+
+void Allocator::check_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy) {
+    uint32_t N = get_num_tenants();
+    if (greedy.size() != N || demands.pos_.size() != demands.val_.size() ||
+        (!demands.pos_.empty() && demands.pos_.back() >= N)) {
+        throw std::invalid_argument("set_sparse_demands(): expected positions below the number of tenants");
+    }
+    for (size_t k = 1; k < demands.pos_.size(); ++k) {
+        if (demands.pos_[k] <= demands.pos_[k - 1]) {
+            throw std::invalid_argument("set_sparse_demands(): expected strictly increasing positions");
+        }
+    }
+}
+
+void Allocator::set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy) {
+    check_sparse_demands(demands, greedy);
+
+    uint32_t N = get_num_tenants();
+    demands.to_dense(N, sparse_demands_);
+    std::vector<bool> listed_greedy(N, false);
+    for (uint32_t pos : demands.pos_) {
+        listed_greedy[pos] = greedy[pos];
+    }
+    sparse_pos_ = demands.pos_;
+    set_demands(sparse_demands_, listed_greedy);
+}
+
+void Allocator::get_sparse_allocations(SparseRow& allocations) {
+    get_allocations(sparse_demands_);
+    allocations.pos_ = sparse_pos_;
+    allocations.val_.resize(sparse_pos_.size());
+    for (size_t k = 0; k < sparse_pos_.size(); ++k) {
+        allocations.val_[k] = sparse_demands_[sparse_pos_[k]];
+    }
+}
@@ -1,21 +1,81 @@
 #include "allocator/bheap.h"
 
+#include <assert.h>
+
+#include <algorithm>
+
 BroadcastHeap::BroadcastHeap() {
 }
 
+void BroadcastHeap::reserve(size_t n) {
+    h_.reserve(n);
+}
+
+void BroadcastHeap::clear() {
+    h_.clear();
+    base_val_ = 0;
+#ifdef ALLOC_STATS
+    pushes_ = 0, pops_ = 0;
+#endif
+}
+
 void BroadcastHeap::push(uint32_t key, int32_t val) {
-    h_.push(std::make_pair(key, val - base_val_));
+    h_.emplace_back(key, val - base_val_);
+    sift_up(h_.size() - 1);
+#ifdef ALLOC_STATS
+    pushes_++;
+#endif
+}
+
+void BroadcastHeap::push_all(const bheap_item* first, const bheap_item* last) {
+    size_t old_size = h_.size();
+    for (auto it = first; it != last; ++it) {
+        h_.emplace_back(it->first, it->second - base_val_);
+    }
+#ifdef ALLOC_STATS
+    pushes_ += h_.size() - old_size;
+#endif
+
+    if (h_.size() - old_size > old_size) {
+        for (size_t i = (h_.size() + ARITY - 2) / ARITY; i-- > 0;) {
+            sift_down(i);
+        }
+    } else {
+        for (size_t i = old_size; i < h_.size(); ++i) {
+            sift_up(i);
+        }
+    }
 }
 
 bheap_item BroadcastHeap::pop() {
-    auto i = h_.top();
-    h_.pop();
+    assert(!h_.empty());
+#ifdef ALLOC_STATS
+    pops_++;
+#endif
+    auto i = h_[0];
+    h_[0] = h_.back();
+    h_.pop_back();
+    if (!h_.empty()) {
+        sift_down(0);
+    }
 
     return std::make_pair(i.first, i.second + base_val_);
 }
 
+void BroadcastHeap::pop_all(std::vector<bheap_item>& out) {
+#ifdef ALLOC_STATS
+    pops_ += h_.size();
+#endif
+    for (auto& [key, val] : h_) {
+        out.emplace_back(key, val + base_val_);
+    }
+    h_.clear();
+    base_val_ = 0;
+}
+
 int32_t BroadcastHeap::min() {
-    return h_.top().second + base_val_;
+    assert(!h_.empty());
+    return h_[0].second + base_val_;
 }
 
 void BroadcastHeap::add_all(int32_t delta) {
@@ -29,3 +89,50 @@ size_t BroadcastHeap::size() {
 bool BroadcastHeap::empty() {
     return size() == 0;
 }
+
+#ifdef ALLOC_STATS
+uint64_t BroadcastHeap::get_pushes() {
+    return pushes_;
+}
+
+uint64_t BroadcastHeap::get_pops() {
+    return pops_;
+}
+#endif
+
+void BroadcastHeap::sift_up(size_t i) {
+    auto item = h_[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / ARITY;
+        if (!before(item, h_[parent])) {
+            break;
+        }
+        h_[i] = h_[parent];
+        i = parent;
+    }
+    h_[i] = item;
+}
+
+void BroadcastHeap::sift_down(size_t i) {
+    auto item = h_[i];
+    size_t n = h_.size();
+    while (true) {
+        size_t first = i * ARITY + 1;
+        if (first >= n) {
+            break;
+        }
+
+        size_t best = first, last = std::min(first + ARITY, n);
+        for (size_t c = first + 1; c < last; ++c) {
+            if (before(h_[c], h_[best])) {
+                best = c;
+            }
+        }
+        if (!before(h_[best], item)) {
+            break;
+        }
+        h_[i] = h_[best];
+        i = best;
+    }
+    h_[i] = item;
+}
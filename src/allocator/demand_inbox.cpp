@@ -0,0 +1,101 @@
+#include "allocator/demand_inbox.h"
+
+#include <stdexcept>
+
+DemandInbox::DemandInbox(uint32_t capacity) : capacity_(capacity) {
+    if (capacity == 0 || capacity >= (1u << 30)) {
+        throw std::invalid_argument("inbox capacity must be in (0, 2^30)");
+    }
+
+    // Keep the table at most half full so probe chains stay short
+    uint32_t table_size = 1;
+    while (table_size < 2 * capacity) {
+        table_size <<= 1;
+    }
+    mask_ = table_size - 1;
+    entries_ = std::make_unique<Entry[]>(table_size);
+}
+
+uint32_t DemandInbox::probe_start(uint32_t id) const {
+    return (id * 0x9E3779B1u) & mask_;
+}
+
+DemandInbox::Entry* DemandInbox::find(uint32_t id) const {
+    for (uint32_t i = probe_start(id);; i = (i + 1) & mask_) {
+        uint32_t key = entries_[i].id_.load(std::memory_order_acquire);
+        if (key == id) {
+            return &entries_[i];
+        } else if (key == EMPTY_KEY) {
+            return nullptr;
+        }
+    }
+}
+
+void DemandInbox::add_tenant(uint32_t id) {
+    if (id == EMPTY_KEY) {
+        throw std::invalid_argument("add_tenant(): tenant ID is reserved");
+    }
+
+    Entry* e = find(id);
+    if (e == nullptr) {
+        if (size_ == capacity_) {
+            throw std::length_error("add_tenant(): inbox is full");
+        }
+        uint32_t i = probe_start(id);
+        while (entries_[i].id_.load(std::memory_order_relaxed) != EMPTY_KEY) {
+            i = (i + 1) & mask_;
+        }
+        e = &entries_[i];
+        e->id_.store(id, std::memory_order_release);
+        size_++;
+    } else if (e->active_.load(std::memory_order_relaxed)) {
+        throw std::out_of_range("add_tenant(): tenant ID already exists");
+    }
+    e->report_.store(0, std::memory_order_relaxed);
+    e->active_.store(true, std::memory_order_release);
+}
+
+void DemandInbox::remove_tenant(uint32_t id) {
+    Entry* e = find(id);
+    if (e == nullptr || !e->active_.load(std::memory_order_relaxed)) {
+        throw std::out_of_range("remove_tenant(): tenant ID does not exist");
+    }
+    e->active_.store(false, std::memory_order_release);
+}
+
+void DemandInbox::set_demand(uint32_t id, uint32_t demand, bool greedy) {
+    Entry* e = find(id);
+    if (e == nullptr || !e->active_.load(std::memory_order_acquire)) {
+        throw std::out_of_range("set_demand(): tenant ID does not exist");
+    }
+    e->report_.store(PENDING | (greedy ? GREEDY : 0) | demand, std::memory_order_release);
+}
+
+size_t DemandInbox::drain(Allocator& alloc) {
+    size_t applied = 0;
+    for (uint32_t i = 0; i <= mask_; ++i) {
+        Entry& e = entries_[i];
+        if (!(e.report_.load(std::memory_order_relaxed) & PENDING)) {
+            continue;
+        }
+
+        uint64_t report = e.report_.exchange(0, std::memory_order_acquire);
+        if ((report & PENDING) && e.active_.load(std::memory_order_relaxed)) {
+            alloc.set_demand(e.id_.load(std::memory_order_relaxed), (uint32_t)report, report & GREEDY);
+            applied++;
+        }
+    }
+    return applied;
+}
+
+uint32_t DemandInbox::find_slot(uint32_t id) const {
+    Entry* e = find(id);
+    if (e == nullptr || !e->active_.load(std::memory_order_acquire)) {
+        return NO_SLOT;
+    }
+    return e - entries_.get();
+}
+
+uint32_t DemandInbox::get_table_size() const {
+    return mask_ + 1;
+}
@@ -0,0 +1,187 @@
+#include "allocator/hierarchical_karma.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+HierarchicalKarmaAllocator::HierarchicalKarmaAllocator(uint64_t num_blocks, float alpha, uint32_t init_credits,
+                                                       uint32_t num_groups, uint32_t num_threads)
+    : Allocator(num_blocks), alpha_(alpha), workers_(std::max(num_threads, 1u)) {
+    if (num_groups == 0) {
+        throw std::invalid_argument("number of groups must be positive");
+    }
+    for (uint32_t g = 0; g < num_groups; ++g) {
+        groups_.push_back(std::make_unique<KarmaAllocator>(0, alpha, init_credits));
+    }
+    group_positions_.resize(num_groups);
+    group_demands_.resize(num_groups);
+    group_allocations_.resize(num_groups);
+    group_greedy_.resize(num_groups);
+}
+
+void HierarchicalKarmaAllocator::add_tenant(uint32_t id) {
+    add_tenant(id, id % groups_.size());
+}
+
+void HierarchicalKarmaAllocator::add_tenant(uint32_t id, uint32_t group) {
+    if (group >= groups_.size()) {
+        throw std::out_of_range("add_tenant(): group ID does not exist");
+    }
+    if (id == PUBLIC_ID || positions_.count(id)) {
+        throw std::out_of_range("add_tenant(): tenant ID already exists");
+    }
+    groups_[group]->add_tenant(id);
+
+    uint32_t pos = ids_.size();
+    positions_[id] = pos;
+    ids_.push_back(id);
+    members_.push_back({group, (uint32_t)group_positions_[group].size()});
+    group_positions_[group].push_back(pos);
+    balanced_ = false;
+}
+
+void HierarchicalKarmaAllocator::remove_tenant(uint32_t id) {
+    uint32_t pos = find(id, "remove_tenant()");
+    Member m = members_[pos];
+    groups_[m.group_]->remove_tenant(id);
+
+    // Mirror the group's own removal, then the global one
+    auto& in_group = group_positions_[m.group_];
+    in_group[m.pos_] = in_group.back();
+    members_[in_group[m.pos_]].pos_ = m.pos_;
+    in_group.pop_back();
+
+    uint32_t last = ids_.size() - 1;
+    if (pos != last) {
+        ids_[pos] = ids_[last];
+        members_[pos] = members_[last];
+        positions_[ids_[pos]] = pos;
+        group_positions_[members_[pos].group_][members_[pos].pos_] = pos;
+    }
+    ids_.pop_back();
+    members_.pop_back();
+    positions_.erase(id);
+    balanced_ = false;
+}
+
+// Splits the blocks across groups in proportion to their sizes, giving the
+// rounding remainder to the largest groups
+void HierarchicalKarmaAllocator::rebalance() {
+    if (balanced_) {
+        return;
+    }
+    balanced_ = true;
+
+    uint64_t N = ids_.size();
+    std::vector<uint64_t> shares(groups_.size(), 0);
+    std::vector<uint32_t> order;
+    uint64_t assigned = 0;
+    for (uint32_t g = 0; g < groups_.size(); ++g) {
+        if (N > 0) {
+            shares[g] = num_blocks_ * group_positions_[g].size() / N;
+        }
+        assigned += shares[g];
+        if (!group_positions_[g].empty()) {
+            order.push_back(g);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return group_positions_[a].size() > group_positions_[b].size();
+    });
+    for (size_t k = 0; assigned < num_blocks_ && !order.empty(); k = (k + 1) % order.size()) {
+        shares[order[k]]++;
+        assigned++;
+    }
+
+    for (uint32_t g = 0; g < groups_.size(); ++g) {
+        if (groups_[g]->get_num_blocks() != shares[g]) {
+            groups_[g]->resize(shares[g]);
+        }
+    }
+}
+
+void HierarchicalKarmaAllocator::allocate() {
+    rebalance();
+    workers_.run(groups_.size(), [this](size_t g) {
+        if (!group_positions_[g].empty()) {
+            groups_[g]->allocate();
+        }
+    });
+}
+
+void HierarchicalKarmaAllocator::set_demand(uint32_t id, uint32_t demand, bool greedy) {
+    uint32_t pos = find(id, "set_demand()");
+    rebalance();
+    groups_[members_[pos].group_]->set_demand(id, demand, greedy);
+}
+
+void HierarchicalKarmaAllocator::set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    if (demands.size() != get_num_tenants() || greedy.size() != get_num_tenants()) {
+        throw std::invalid_argument("set_demands(): expected one demand per tenant");
+    }
+    rebalance();
+
+    for (uint32_t g = 0; g < groups_.size(); ++g) {
+        const auto& in_group = group_positions_[g];
+        group_demands_[g].resize(in_group.size());
+        group_greedy_[g].resize(in_group.size());
+        for (uint32_t k = 0; k < in_group.size(); ++k) {
+            group_demands_[g][k] = demands[in_group[k]];
+            group_greedy_[g][k] = greedy[in_group[k]];
+        }
+        groups_[g]->set_demands(group_demands_[g], group_greedy_[g]);
+    }
+}
+
+uint32_t HierarchicalKarmaAllocator::get_fair_share() {
+    return (num_blocks_ - (uint64_t)(alpha_ * num_blocks_)) / get_num_tenants();
+}
+
+uint32_t HierarchicalKarmaAllocator::get_num_tenants() {
+    return ids_.size();
+}
+
+uint32_t HierarchicalKarmaAllocator::get_allocation(uint32_t id) {
+    uint32_t pos = find(id, "get_allocation()");
+    return groups_[members_[pos].group_]->get_allocation(id);
+}
+
+void HierarchicalKarmaAllocator::get_allocations(std::vector<uint32_t>& allocations) {
+    allocations.resize(ids_.size());
+    for (uint32_t g = 0; g < groups_.size(); ++g) {
+        const auto& in_group = group_positions_[g];
+        groups_[g]->get_allocations(group_allocations_[g]);
+        for (uint32_t k = 0; k < in_group.size(); ++k) {
+            allocations[in_group[k]] = group_allocations_[g][k];
+        }
+    }
+}
+
+uint32_t HierarchicalKarmaAllocator::get_credits(uint32_t id) {
+    uint32_t pos = find(id, "get_credits()");
+    return groups_[members_[pos].group_]->get_credits(id);
+}
+
+uint32_t HierarchicalKarmaAllocator::get_num_groups() {
+    return groups_.size();
+}
+
+uint32_t HierarchicalKarmaAllocator::get_group(uint32_t id) {
+    return members_[find(id, "get_group()")].group_;
+}
+
+KarmaAllocator& HierarchicalKarmaAllocator::get_group_allocator(uint32_t group) {
+    if (group >= groups_.size()) {
+        throw std::out_of_range("get_group_allocator(): group ID does not exist");
+    }
+    rebalance();
+    return *groups_[group];
+}
+
+uint32_t HierarchicalKarmaAllocator::find(uint32_t id, const char* fn) {
+    auto it = positions_.find(id);
+    if (it == positions_.end()) {
+        throw std::out_of_range(std::string(fn) + ": tenant ID does not exist");
+    }
+    return it->second;
+}
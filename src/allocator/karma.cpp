@@ -3,65 +3,184 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <stdexcept>
+
+template <typename F>
+size_t KarmaAllocator::for_chunks(size_t n, F f) {
+    size_t num_chunks = workers_ ? std::min<size_t>(workers_->get_num_threads(), n / PARALLEL_GRAIN) : 1;
+    if (num_chunks <= 1) {
+        f(0, 0, n);
+        return 1;
+    }
+    workers_->run(num_chunks, [&](size_t c) {
+        f(c, n * c / num_chunks, n * (c + 1) / num_chunks);
+    });
+    return num_chunks;
+}
+
+template <typename Compare>
+void KarmaAllocator::sort_candidates(std::vector<Candidate>& candidates, Compare comp) {
+    size_t n = candidates.size();
+    size_t num_chunks = for_chunks(n, [&](size_t, size_t begin, size_t end) {
+        std::sort(candidates.begin() + begin, candidates.begin() + end, comp);
+    });
 
-#include "allocator/bheap.h"
+    auto bound = [&](size_t c) {
+        return candidates.begin() + n * std::min(c, num_chunks) / num_chunks;
+    };
+    for (size_t width = 1; width < num_chunks; width *= 2) {
+        workers_->run((num_chunks + 2 * width - 1) / (2 * width), [&](size_t p) {
+            size_t first = 2 * p * width;
+            std::inplace_merge(bound(first), bound(first + width), bound(first + 2 * width), comp);
+        });
+    }
+}
+
+struct KarmaAllocator::SortedDonors {
+    std::vector<Candidate> donor_c_;
+    size_t idx_ = 0;
+
+    SortedDonors(KarmaAllocator& alloc, std::vector<uint32_t>& donors) {
+        donor_c_.assign(donors.size(), Candidate(DUMMY_ID, 0, 0));
+        alloc.for_chunks(donors.size(), [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t s = donors[i];
+                donor_c_[i] = Candidate(s, alloc.get_slot_credits(s), alloc.get_block_surplus(s));
+            }
+        });
+        alloc.sort_candidates(donor_c_, [](const Candidate& a, const Candidate& b) {
+            return a.credits_ < b.credits_;
+        });
+        donor_c_.emplace_back(DUMMY_ID, std::numeric_limits<uint32_t>::max(), 0);
+    }
+
+    const Candidate& front() {
+        return donor_c_[idx_];
+    }
+
+    void pop() {
+        idx_++;
+    }
+};
+
+struct KarmaAllocator::OrderedDonors {
+    KarmaAllocator& alloc_;
+    Candidate public_, front_;
+    size_t idx_ = 0;
+    bool public_drained_ = false;
+
+    // The public donor is not kept in donor_order_ and is merged in here
+    OrderedDonors(KarmaAllocator& alloc)
+        : alloc_(alloc),
+          public_(PUBLIC_SLOT, alloc.get_slot_credits(PUBLIC_SLOT), alloc.public_blocks_),
+          front_(DUMMY_ID, 0, 0) {
+        public_drained_ = alloc.public_blocks_ == 0;
+        load();
+    }
+
+    const Candidate& front() {
+        return front_;
+    }
+
+    void pop() {
+        if (front_.slot_ == PUBLIC_SLOT) {
+            public_drained_ = true;
+        } else {
+            idx_++;
+        }
+        load();
+    }
+
+    void load() {
+        const auto& order = alloc_.donor_order_;
+        if (idx_ < order.size() && (public_drained_ || order[idx_].first + alloc_.accrued_ < public_.credits_)) {
+            uint32_t s = order[idx_].second;
+            front_ = Candidate(s, order[idx_].first + alloc_.accrued_, alloc_.get_block_surplus(s));
+        } else if (!public_drained_) {
+            front_ = public_;
+        } else {
+            front_ = Candidate(DUMMY_ID, std::numeric_limits<uint32_t>::max(), 0);
+        }
+    }
+};
 
 KarmaAllocator::KarmaAllocator(uint64_t num_blocks, float alpha, uint32_t init_credits)
-    : Allocator(num_blocks), init_credits_(init_credits) {
+    : Allocator(num_blocks), alpha_(alpha), init_credits_(init_credits) {
     if (alpha < 0 || alpha > 1) {
         throw std::invalid_argument("alpha must be between 0 and 1");
     }
 
     public_blocks_ = alpha * num_blocks_;
-    tenants_.emplace(PUBLIC_ID, 0);
+    tenants_.add(PUBLIC_ID);
+    credits_.push_back(0);
+    rates_.push_back(0);
+    chunks_.resize(1);
 }
 
 void KarmaAllocator::add_tenant(uint32_t id) {
-    if (id == DUMMY_ID || tenants_.find(id) != tenants_.end()) {
+    if (id == DUMMY_ID || tenants_.contains(id)) {
         throw std::out_of_range("add_tenant(): tenant ID already exists");
     }
 
-    uint64_t total_credits = 0;
-    for (const auto& [id, t] : tenants_) {
-        total_credits += t.credits_;
-    }
-
-    uint32_t credits = get_num_tenants() > 0 ? total_credits / get_num_tenants() : init_credits_;
-    tenants_.emplace(id, credits);
+    uint32_t credits = get_num_tenants() > 0 ? total_credits_ / get_num_tenants() : init_credits_;
+    tenants_.add(id);
+    credits_.push_back(0);
+    rates_.push_back(0);
+    set_slot_credits(credits_.size() - 1, credits);
+    total_credits_ += credits;
+    stale_ = true;
+    sparse_ = false;
 }
 
 void KarmaAllocator::remove_tenant(uint32_t id) {
-    if (id == PUBLIC_ID || tenants_.find(id) == tenants_.end()) {
+    if (id == PUBLIC_ID || !tenants_.contains(id)) {
         throw std::out_of_range("remove_tenant(): tenant ID does not exist");
     }
-    tenants_.erase(id);
+    total_credits_ -= get_slot_credits(tenants_.find(id));
+    uint32_t slot = tenants_.remove(id);
+    erase_slot(credits_, slot);
+    erase_slot(rates_, slot);
+    stale_ = true;
+    sparse_ = false;
 }
 
 void KarmaAllocator::allocate() {
+    if (incremental_) {
+        allocate_incremental();
+        return;
+    }
+
     std::vector<uint32_t> donors, borrowers;
     uint32_t fair_share = get_fair_share();
+    uint32_t num_tenants = get_num_tenants();
     uint64_t supply = public_blocks_, demand = 0;
 
-    for (auto& [id, t] : tenants_) {
-        t.rate_ = 0;
-        if (id == PUBLIC_ID) {
-            t.credits_ = init_credits_ * get_num_tenants();
-            continue;
-        }
-        t.credits_ += public_blocks_ / get_num_tenants();
-
-        if (t.demand_ < fair_share) {
-            donors.push_back(id);
-            supply += fair_share - t.demand_;
-        } else if (t.demand_ > fair_share) {
-            borrowers.push_back(id);
-            demand += std::min(t.demand_ - fair_share, t.credits_);
+    uint32_t accrual = public_blocks_ / num_tenants;
+    accrued_ += accrual;
+    total_credits_ += (uint64_t)accrual * num_tenants;
+    set_slot_credits(PUBLIC_SLOT, init_credits_ * num_tenants);
+
+    {
+        STATS_PHASE(KARMA_CLASSIFY);
+        uint32_t first = PUBLIC_SLOT + 1;
+        size_t num_chunks = for_chunks(tenants_.size() - first, [&](size_t c, size_t begin, size_t end) {
+            classify(chunks_[c], first + begin, first + end, fair_share);
+        });
+
+        donors = std::move(chunks_[0].donors_);
+        borrowers = std::move(chunks_[0].borrowers_);
+        for (size_t c = 0; c < num_chunks; ++c) {
+            if (c > 0) {
+                donors.insert(donors.end(), chunks_[c].donors_.begin(), chunks_[c].donors_.end());
+                borrowers.insert(borrowers.end(), chunks_[c].borrowers_.begin(), chunks_[c].borrowers_.end());
+            }
+            supply += chunks_[c].supply_;
+            demand += chunks_[c].demand_;
         }
-        t.allocation_ = std::min(t.demand_, fair_share);
     }
 
     if (public_blocks_ > 0) {
-        donors.push_back(PUBLIC_ID);
+        donors.push_back(PUBLIC_SLOT);
     }
 
     if (supply >= demand) {
@@ -70,80 +189,376 @@ void KarmaAllocator::allocate() {
         donate_to_rich(supply, donors, borrowers);
     }
 
-    for (auto& [id, t] : tenants_) {
-        if (id == PUBLIC_ID) {
-            t.credits_ = 0;
-        } else {
-            t.credits_ += t.rate_;
+    // Only donors and borrowers have a rate
+    STATS_PHASE(KARMA_CREDITS);
+    apply_rates(donors);
+    apply_rates(borrowers);
+    set_slot_credits(PUBLIC_SLOT, 0);
+}
+
+void KarmaAllocator::classify(Chunk& chunk, uint32_t begin, uint32_t end, uint32_t fair_share) {
+    const auto& demands = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
+
+    chunk.donors_.clear();
+    chunk.borrowers_.clear();
+    chunk.supply_ = chunk.demand_ = 0;
+    for (uint32_t s = begin; s < end; ++s) {
+        if (demands[s] < fair_share) {
+            chunk.donors_.push_back(s);
+            chunk.supply_ += fair_share - demands[s];
+        } else if (demands[s] > fair_share) {
+            chunk.borrowers_.push_back(s);
+            chunk.demand_ += std::min(demands[s] - fair_share, get_slot_credits(s));
         }
+        allocations[s] = std::min(demands[s], fair_share);
+    }
+}
+
+void KarmaAllocator::allocate_incremental() {
+    uint32_t fair_share = get_fair_share();
+    uint32_t num_tenants = get_num_tenants();
+
+    const auto& demands = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
+
+    {
+        STATS_PHASE(KARMA_CLASSIFY);
+        if (stale_ || fair_share != role_fair_share_) {
+            rebuild_roles();
+        }
+        STATS_ADD(KARMA_CHANGED_TENANTS, changed_.size());
+        for (uint32_t s : changed_) {
+            update_role(s);
+        }
+        changed_.clear();
+        merge_donor_changes();
+    }
+
+    uint32_t accrual = public_blocks_ / num_tenants;
+    accrued_ += accrual;
+    total_credits_ += (uint64_t)accrual * num_tenants;
+    set_slot_credits(PUBLIC_SLOT, init_credits_ * num_tenants);
+
+    uint64_t supply = public_blocks_ + donor_surplus_, demand = 0;
+    for (uint32_t s : borrower_list_) {
+        demand += std::min(demands[s] - fair_share, get_slot_credits(s));
+        allocations[s] = fair_share;
+    }
+
+    if (supply >= demand) {
+        lend_to_borrowers(borrower_list_);
+
+        OrderedDonors ordered(*this);
+        drain_donors(demand, ordered);
+
+        STATS_PHASE(KARMA_SORT);
+        reorder_drained(ordered.idx_);
+
+        for (uint32_t s : borrower_list_) {
+            apply_rate(s);
+        }
+        rates_[PUBLIC_SLOT] = 0;
+    } else {
+        std::vector<uint32_t> donors;
+        for (const auto& [_, s] : donor_order_) {
+            donors.push_back(s);
+        }
+        if (public_blocks_ > 0) {
+            donors.push_back(PUBLIC_SLOT);
+        }
+        donate_to_rich(supply, donors, borrower_list_);
+
+        // Every donor's credits moved, so the order is rebuilt next quantum
+        apply_rates(donors);
+        apply_rates(borrower_list_);
+        rates_[PUBLIC_SLOT] = 0;
+        stale_ = true;
+    }
+    set_slot_credits(PUBLIC_SLOT, 0);
+}
+
+void KarmaAllocator::reorder_drained(size_t drained) {
+    // Donors reached by drain_donors() form a prefix of the order; only those
+    // that actually donated have moved and need to be merged back in
+    auto mid = donor_order_.begin() + drained;
+    auto kept = std::stable_partition(donor_order_.begin(), mid, [&](const auto& d) {
+        return rates_[d.second] == 0;
+    });
+    for (auto it = kept; it != mid; ++it) {
+        uint32_t s = it->second;
+        it->first += rates_[s];
+        apply_rate(s);
+    }
+
+    std::sort(kept, mid);
+    std::inplace_merge(donor_order_.begin(), kept, mid);
+    if (mid != donor_order_.end() && drained > 0 && *mid < *(mid - 1)) {
+        std::inplace_merge(donor_order_.begin(), mid, donor_order_.end());
+    }
+}
+
+void KarmaAllocator::rebuild_roles() {
+    role_fair_share_ = get_fair_share();
+    donor_surplus_ = 0;
+    donor_order_.clear();
+    borrower_list_.clear();
+    borrower_pos_.assign(tenants_.size(), NO_SLOT);
+    changed_.clear();
+    donor_joins_.clear();
+    donor_leaves_.clear();
+
+    applied_demands_ = tenants_.demands_;
+    for (uint32_t s = PUBLIC_SLOT + 1; s < tenants_.size(); ++s) {
+        join_role(s, applied_demands_[s]);
+    }
+    std::swap(donor_order_, donor_joins_);
+    std::sort(donor_order_.begin(), donor_order_.end());
+    stale_ = false;
+}
+
+void KarmaAllocator::update_role(uint32_t slot) {
+    uint32_t demand = tenants_.demands_[slot];
+    if (applied_demands_[slot] != demand) {
+        leave_role(slot, applied_demands_[slot]);
+        join_role(slot, demand);
+        applied_demands_[slot] = demand;
+    }
+}
+
+void KarmaAllocator::join_role(uint32_t slot, uint32_t demand) {
+    if (demand < role_fair_share_) {
+        donor_surplus_ += role_fair_share_ - demand;
+        donor_joins_.emplace_back(credits_[slot], slot);
+    } else if (demand > role_fair_share_) {
+        borrower_pos_[slot] = borrower_list_.size();
+        borrower_list_.push_back(slot);
     }
+    tenants_.allocations_[slot] = std::min(demand, role_fair_share_);
+}
+
+void KarmaAllocator::leave_role(uint32_t slot, uint32_t demand) {
+    if (demand < role_fair_share_) {
+        donor_surplus_ -= role_fair_share_ - demand;
+        donor_leaves_.emplace_back(credits_[slot], slot);
+    } else if (demand > role_fair_share_) {
+        uint32_t pos = borrower_pos_[slot];
+        borrower_pos_[borrower_list_.back()] = pos;
+        erase_slot(borrower_list_, pos);
+        borrower_pos_[slot] = NO_SLOT;
+    }
+}
+
+void KarmaAllocator::merge_donor_changes() {
+    if (!donor_leaves_.empty()) {
+        std::sort(donor_leaves_.begin(), donor_leaves_.end());
+        auto leave = donor_leaves_.begin();
+        auto left = std::remove_if(donor_order_.begin(), donor_order_.end(), [&](const auto& d) {
+            if (leave != donor_leaves_.end() && *leave == d) {
+                ++leave;
+                return true;
+            }
+            return false;
+        });
+        assert(leave == donor_leaves_.end());
+        donor_order_.erase(left, donor_order_.end());
+        donor_leaves_.clear();
+    }
+
+    if (!donor_joins_.empty()) {
+        std::sort(donor_joins_.begin(), donor_joins_.end());
+        size_t mid = donor_order_.size();
+        donor_order_.insert(donor_order_.end(), donor_joins_.begin(), donor_joins_.end());
+        std::inplace_merge(donor_order_.begin(), donor_order_.begin() + mid, donor_order_.end());
+        donor_joins_.clear();
+    }
+}
+
+void KarmaAllocator::set_incremental(bool incremental) {
+    incremental_ = incremental;
+    stale_ = true;
+}
+
+void KarmaAllocator::set_num_threads(uint32_t num_threads) {
+    if (num_threads == 0) {
+        throw std::invalid_argument("number of threads must be > 0");
+    }
+    workers_ = num_threads > 1 ? std::make_unique<ThreadPool>(num_threads) : nullptr;
+    chunks_.resize(num_threads);
+}
+
+void KarmaAllocator::resize(uint64_t num_blocks) {
+    num_blocks_ = num_blocks;
+    public_blocks_ = alpha_ * num_blocks;
+    stale_ = true;
+}
+
+void KarmaAllocator::store_demand(uint32_t slot, uint32_t demand) {
+    if (incremental_ && !stale_ && tenants_.demands_[slot] != demand) {
+        changed_.push_back(slot);
+    }
+    tenants_.demands_[slot] = demand;
 }
 
 void KarmaAllocator::set_demand(uint32_t id, uint32_t demand, bool greedy) {
-    auto it = tenants_.find(id);
-    if (id == PUBLIC_ID || it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (id == PUBLIC_ID || slot == NO_SLOT) {
         throw std::out_of_range("set_demand(): tenant ID does not exist");
     }
 
     if (greedy) {
         demand = std::max(get_fair_share(), demand);
     }
-    it->second.demand_ = demand;
+    store_demand(slot, demand);
+    sparse_ = false;
+}
+
+void KarmaAllocator::set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    if (demands.size() != get_num_tenants() || greedy.size() != get_num_tenants()) {
+        throw std::invalid_argument("set_demands(): expected one demand per tenant");
+    }
+    if (demands.empty()) {
+        return;
+    }
+
+    uint32_t fair_share = get_fair_share();
+    for (uint32_t k = 0; k < demands.size(); ++k) {
+        store_demand(PUBLIC_SLOT + 1 + k, greedy[k] ? std::max(fair_share, demands[k]) : demands[k]);
+    }
+    sparse_ = false;
+}
+
+void KarmaAllocator::set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy) {
+    check_sparse_demands(demands, greedy);
+
+    if (!sparse_) {
+        active_.clear();
+        for (uint32_t s = PUBLIC_SLOT + 1; s < tenants_.size(); ++s) {
+            active_.push_back(s);
+        }
+        sparse_ = true;
+    }
+
+    // Both lists are ascending, so one merge finds the tenants that went idle
+    uint32_t fair_share = get_fair_share();
+    next_active_.clear();
+    size_t prev = 0;
+    for (size_t k = 0; k < demands.size(); ++k) {
+        uint32_t pos = demands.pos_[k];
+        uint32_t s = PUBLIC_SLOT + 1 + pos;
+        for (; prev < active_.size() && active_[prev] < s; ++prev) {
+            store_demand(active_[prev], 0);
+        }
+        if (prev < active_.size() && active_[prev] == s) {
+            prev++;
+        }
+        store_demand(s, greedy[pos] ? std::max(fair_share, demands.val_[k]) : demands.val_[k]);
+        next_active_.push_back(s);
+    }
+    for (; prev < active_.size(); ++prev) {
+        store_demand(active_[prev], 0);
+    }
+    std::swap(active_, next_active_);
+}
+
+void KarmaAllocator::get_sparse_allocations(SparseRow& allocations) {
+    allocations.clear();
+    for (uint32_t s : active_) {
+        allocations.push_back(s - PUBLIC_SLOT - 1, tenants_.allocations_[s]);
+    }
 }
 
 uint32_t KarmaAllocator::get_num_tenants() {
     return tenants_.size() - 1;
 }
 
-uint32_t KarmaAllocator::get_block_surplus(uint32_t id) {
-    if (id == PUBLIC_ID) {
+uint32_t KarmaAllocator::get_block_surplus(uint32_t slot) {
+    if (slot == PUBLIC_SLOT) {
         return public_blocks_;
     }
-    return get_fair_share() - tenants_[id].demand_;
+    return get_fair_share() - tenants_.demands_[slot];
 }
 
-uint64_t KarmaAllocator::get_free_blocks() {
-    return num_blocks_ - public_blocks_;
+uint32_t KarmaAllocator::get_slot_credits(uint32_t slot) {
+    return credits_[slot] + accrued_;
 }
 
-void KarmaAllocator::borrow_from_poor(uint64_t demand, std::vector<uint32_t>& donors, std::vector<uint32_t>& borrowers) {
-    uint32_t fair_share = get_fair_share();
-    for (uint32_t id : borrowers) {
-        uint32_t to_borrow = std::min(tenants_[id].credits_, tenants_[id].demand_ - fair_share);
-        tenants_[id].allocation_ += to_borrow;
-        tenants_[id].rate_ -= to_borrow;
+void KarmaAllocator::set_slot_credits(uint32_t slot, uint32_t credits) {
+    credits_[slot] = (int64_t)credits - accrued_;
+}
+
+void KarmaAllocator::apply_rate(uint32_t slot) {
+    credits_[slot] += rates_[slot];
+    if (slot != PUBLIC_SLOT) {
+        total_credits_ += rates_[slot];
     }
+    rates_[slot] = 0;
+}
 
-    std::vector<Candidate> donor_c;
-    for (uint32_t id : donors) {
-        donor_c.emplace_back(id, tenants_[id].credits_, get_block_surplus(id));
+void KarmaAllocator::apply_rates(const std::vector<uint32_t>& slots) {
+    size_t num_chunks = for_chunks(slots.size(), [&](size_t c, size_t begin, size_t end) {
+        uint64_t credits = 0;
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t s = slots[i];
+            credits_[s] += rates_[s];
+            if (s != PUBLIC_SLOT) {
+                credits += rates_[s];
+            }
+            rates_[s] = 0;
+        }
+        chunks_[c].credits_ = credits;
+    });
+    for (size_t c = 0; c < num_chunks; ++c) {
+        total_credits_ += chunks_[c].credits_;
     }
-    std::sort(donor_c.begin(), donor_c.end(), [](const Candidate& a, const Candidate& b) {
-        return a.credits_ < b.credits_;
+}
+
+uint64_t KarmaAllocator::get_free_blocks() {
+    return num_blocks_ - public_blocks_;
+}
+
+void KarmaAllocator::lend_to_borrowers(std::vector<uint32_t>& borrowers) {
+    uint32_t fair_share = get_fair_share();
+    const auto& demands = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
+
+    for_chunks(borrowers.size(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t s = borrowers[i];
+            uint32_t to_borrow = std::min(get_slot_credits(s), demands[s] - fair_share);
+            allocations[s] += to_borrow;
+            rates_[s] -= to_borrow;
+        }
     });
-    donor_c.emplace_back(DUMMY_ID, std::numeric_limits<uint32_t>::max(), 0);
+}
 
-    int64_t curr_c = -1, next_c = donor_c[0].credits_;
+template <typename Donors>
+void KarmaAllocator::drain_donors(uint64_t demand, Donors& donors) {
+    int64_t curr_c = -1, next_c = donors.front().credits_;
 
-    size_t idx = 0;
-    auto poorest_donors = BroadcastHeap();
+    STATS_PHASE(KARMA_EXCHANGE);
+    auto& poorest_donors = heap_;
+    poorest_donors.clear();
 
     while (demand > 0) {
+        STATS_ADD(KARMA_EXCHANGE_ROUNDS, 1);
         if (poorest_donors.empty()) {
             curr_c = next_c;
             assert(curr_c < std::numeric_limits<uint32_t>::max());
         }
 
-        while (donor_c[idx].credits_ == curr_c) {
-            poorest_donors.push(donor_c[idx].id_, donor_c[idx].blocks_);
-            idx++;
+        heap_batch_.clear();
+        while (donors.front().credits_ == curr_c) {
+            heap_batch_.emplace_back(donors.front().slot_, donors.front().blocks_);
+            donors.pop();
         }
-        next_c = donor_c[idx].credits_;
+        poorest_donors.push_all(heap_batch_.data(), heap_batch_.data() + heap_batch_.size());
+        next_c = donors.front().credits_;
 
         if (demand < poorest_donors.size()) {
             for (uint32_t i = 0; i < demand; ++i) {
-                auto [id, v] = poorest_donors.pop();
-                tenants_[id].rate_ += get_block_surplus(id) - v + 1;
+                auto [s, v] = poorest_donors.pop();
+                rates_[s] += get_block_surplus(s) - v + 1;
             }
             demand = 0;
         } else {
@@ -155,59 +570,89 @@ void KarmaAllocator::borrow_from_poor(uint64_t demand, std::vector<uint32_t>& do
         }
 
         while (!poorest_donors.empty() && poorest_donors.min() == 0) {
-            auto [id, _] = poorest_donors.pop();
-            tenants_[id].rate_ += get_block_surplus(id);
+            auto [s, _] = poorest_donors.pop();
+            rates_[s] += get_block_surplus(s);
         }
     }
 
-    while (!poorest_donors.empty()) {
-        auto [id, v] = poorest_donors.pop();
-        tenants_[id].rate_ += get_block_surplus(id) - v;
+    // The rest lent independently of each other, so their order is moot
+    heap_batch_.clear();
+    poorest_donors.pop_all(heap_batch_);
+    for (auto [s, v] : heap_batch_) {
+        rates_[s] += get_block_surplus(s) - v;
     }
+    STATS_ADD(KARMA_HEAP_PUSHES, poorest_donors.get_pushes());
+    STATS_ADD(KARMA_HEAP_POPS, poorest_donors.get_pops());
+}
+
+void KarmaAllocator::borrow_from_poor(uint64_t demand, std::vector<uint32_t>& donors, std::vector<uint32_t>& borrowers) {
+    lend_to_borrowers(borrowers);
+
+    SortedDonors sorted = [&] {
+        STATS_PHASE(KARMA_SORT);
+        return SortedDonors(*this, donors);
+    }();
+    drain_donors(demand, sorted);
 }
 
 void KarmaAllocator::donate_to_rich(uint64_t supply, std::vector<uint32_t>& donors, std::vector<uint32_t>& borrowers) {
     uint32_t fair_share = get_fair_share();
-    for (uint32_t id : donors) {
-        uint32_t to_donate = get_block_surplus(id);
-        tenants_[id].rate_ += to_donate;
-    }
+    const auto& demands = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
 
-    std::vector<Candidate> borrower_c;
-    for (uint32_t id : borrowers) {
-        uint32_t blocks = std::min(tenants_[id].credits_, tenants_[id].demand_ - fair_share);
-        borrower_c.emplace_back(id, tenants_[id].credits_, blocks);
-    }
-    std::sort(borrower_c.begin(), borrower_c.end(), [](const Candidate& a, const Candidate& b) {
-        return a.credits_ > b.credits_;
+    for_chunks(donors.size(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t s = donors[i];
+            rates_[s] += get_block_surplus(s);
+        }
     });
-    borrower_c.emplace_back(DUMMY_ID, -1, 0);
+
+    std::vector<Candidate> borrower_c(borrowers.size(), Candidate(DUMMY_ID, 0, 0));
+    {
+        STATS_PHASE(KARMA_SORT);
+        for_chunks(borrowers.size(), [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t s = borrowers[i];
+                uint32_t blocks = std::min(get_slot_credits(s), demands[s] - fair_share);
+                borrower_c[i] = Candidate(s, get_slot_credits(s), blocks);
+            }
+        });
+        sort_candidates(borrower_c, [](const Candidate& a, const Candidate& b) {
+            return a.credits_ > b.credits_;
+        });
+        borrower_c.emplace_back(DUMMY_ID, -1, 0);
+    }
 
     int64_t curr_c = std::numeric_limits<int32_t>::max(), next_c = borrower_c[0].credits_;
 
+    STATS_PHASE(KARMA_EXCHANGE);
     size_t idx = 0;
-    auto richest_borrowers = BroadcastHeap();
+    auto& richest_borrowers = heap_;
+    richest_borrowers.clear();
 
     while (supply > 0) {
+        STATS_ADD(KARMA_EXCHANGE_ROUNDS, 1);
         if (richest_borrowers.empty()) {
             curr_c = next_c;
             assert(curr_c > -1);
         }
 
+        heap_batch_.clear();
         while (borrower_c[idx].credits_ == curr_c) {
-            richest_borrowers.push(borrower_c[idx].id_, borrower_c[idx].blocks_);
+            heap_batch_.emplace_back(borrower_c[idx].slot_, borrower_c[idx].blocks_);
             idx++;
         }
+        richest_borrowers.push_all(heap_batch_.data(), heap_batch_.data() + heap_batch_.size());
         next_c = borrower_c[idx].credits_;
 
         if (supply < richest_borrowers.size()) {
             for (uint32_t i = 0; i < supply; ++i) {
-                auto [id, v] = richest_borrowers.pop();
+                auto [s, v] = richest_borrowers.pop();
                 supply--;
 
-                int32_t delta = std::min(tenants_[id].credits_, tenants_[id].demand_ - fair_share) - v + 1;
-                tenants_[id].allocation_ += delta;
-                tenants_[id].rate_ -= delta;
+                int32_t delta = std::min(get_slot_credits(s), demands[s] - fair_share) - v + 1;
+                allocations[s] += delta;
+                rates_[s] -= delta;
             }
             supply = 0;
         } else {
@@ -218,19 +663,22 @@ void KarmaAllocator::donate_to_rich(uint64_t supply, std::vector<uint32_t>& dono
         }
 
         while (!richest_borrowers.empty() && richest_borrowers.min() == 0) {
-            auto [id, _] = richest_borrowers.pop();
-            int64_t delta = std::min(tenants_[id].credits_, tenants_[id].demand_ - fair_share);
-            tenants_[id].allocation_ += delta;
-            tenants_[id].rate_ -= delta;
+            auto [s, _] = richest_borrowers.pop();
+            int64_t delta = std::min(get_slot_credits(s), demands[s] - fair_share);
+            allocations[s] += delta;
+            rates_[s] -= delta;
         }
     }
 
-    while (!richest_borrowers.empty()) {
-        auto [id, v] = richest_borrowers.pop();
-        int32_t delta = std::min(tenants_[id].credits_, tenants_[id].demand_ - fair_share) - v;
-        tenants_[id].allocation_ += delta;
-        tenants_[id].rate_ -= delta;
+    heap_batch_.clear();
+    richest_borrowers.pop_all(heap_batch_);
+    for (auto [s, v] : heap_batch_) {
+        int32_t delta = std::min(get_slot_credits(s), demands[s] - fair_share) - v;
+        allocations[s] += delta;
+        rates_[s] -= delta;
     }
+    STATS_ADD(KARMA_HEAP_PUSHES, richest_borrowers.get_pushes());
+    STATS_ADD(KARMA_HEAP_POPS, richest_borrowers.get_pops());
 }
 
 uint32_t KarmaAllocator::get_fair_share() {
@@ -238,17 +686,21 @@ uint32_t KarmaAllocator::get_fair_share() {
 }
 
 uint32_t KarmaAllocator::get_allocation(uint32_t id) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_allocation(): tenant ID does not exist");
     }
-    return it->second.allocation_;
+    return tenants_.allocations_[slot];
+}
+
+void KarmaAllocator::get_allocations(std::vector<uint32_t>& allocations) {
+    allocations.assign(tenants_.allocations_.begin() + PUBLIC_SLOT + 1, tenants_.allocations_.end());
 }
 
 uint32_t KarmaAllocator::get_credits(uint32_t id) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_allocation(): tenant ID does not exist");
     }
-    return it->second.credits_;
+    return get_slot_credits(slot);
 }
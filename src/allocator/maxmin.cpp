@@ -2,78 +2,220 @@
 
 #include <assert.h>
 
-#include "allocator/bheap.h"
+#include <algorithm>
+#include <limits>
 
 MaxMinAllocator::MaxMinAllocator(uint64_t num_blocks) : Allocator(num_blocks) {
 }
 
 void MaxMinAllocator::add_tenant(uint32_t id) {
-    if (tenants_.find(id) != tenants_.end()) {
+    if (tenants_.contains(id)) {
         throw std::out_of_range("add_tenant(): tenant ID already exists");
     }
-    tenants_[id] = Tenant();
+    tenants_.add(id);
+    sparse_ = false;
 }
 
 void MaxMinAllocator::remove_tenant(uint32_t id) {
-    if (tenants_.find(id) != tenants_.end()) {
+    if (!tenants_.contains(id)) {
         throw std::out_of_range("remove_tenant(): tenant ID does not exist");
     }
-    tenants_.erase(id);
+    tenants_.remove(id);
+    sparse_ = false;
 }
 
 void MaxMinAllocator::allocate() {
+    if (sparse_) {
+        allocate_sparse();
+        return;
+    }
+    const auto& demands = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
+
     uint64_t total_demand = 0;
-    for (auto& [_, t] : tenants_) {
-        total_demand += t.demand_;
+    for (uint32_t d : demands) {
+        total_demand += d;
     }
 
     if (total_demand < num_blocks_) {
-        for (auto& [_, t] : tenants_) {
-            t.allocation_ = t.demand_;
-        }
+        allocations = demands;
     } else {
-        auto h = BroadcastHeap();
-        for (const auto& [id, t] : tenants_) {
-            h.push(id, t.demand_);
+        uint32_t level;
+        {
+            STATS_PHASE(MAXMIN_LEVEL);
+            scratch_ = demands;
+            level = get_water_level();
         }
 
-        uint64_t supply = num_blocks_;
-        while (supply > 0) {
-            if (supply < h.size()) {
-                for (uint32_t i = 0; i < supply; ++i) {
-                    auto [id, v] = h.pop();
-                    tenants_[id].allocation_ = tenants_[id].demand_ - v + 1;
-                }
-                supply = 0;
-            } else {
-                int32_t alpha = std::min((int64_t)h.min(), (int64_t)(supply / h.size()));
-                h.add_all(-alpha);
-                supply -= h.size() * alpha;
-            }
+        STATS_PHASE(MAXMIN_FILL);
+        uint64_t used = 0;
+        for (uint32_t s = 0; s < tenants_.size(); ++s) {
+            allocations[s] = std::min(demands[s], level);
+            used += allocations[s];
+        }
+        distribute_remainder(num_blocks_ - used, level);
+    }
+}
 
-            while (!h.empty() && h.min() == 0) {
-                auto [id, _] = h.pop();
-                tenants_[id].allocation_ = tenants_[id].demand_;
+// Idle tenants neither raise the water level nor take remainder blocks, so
+// leaving them out gives the same allocations as allocate()
+void MaxMinAllocator::allocate_sparse() {
+    const auto& demands = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
+
+    uint64_t total_demand = 0;
+    for (uint32_t s : active_) {
+        total_demand += demands[s];
+    }
+
+    if (total_demand < num_blocks_) {
+        for (uint32_t s : active_) {
+            allocations[s] = demands[s];
+        }
+    } else {
+        uint32_t level;
+        {
+            STATS_PHASE(MAXMIN_LEVEL);
+            scratch_.clear();
+            for (uint32_t s : active_) {
+                scratch_.push_back(demands[s]);
             }
+            level = get_water_level();
         }
 
-        while (!h.empty()) {
-            auto [id, v] = h.pop();
-            tenants_[id].allocation_ = tenants_[id].demand_ - v;
+        STATS_PHASE(MAXMIN_FILL);
+        uint64_t used = 0;
+        for (uint32_t s : active_) {
+            allocations[s] = std::min(demands[s], level);
+            used += allocations[s];
         }
+        distribute_remainder(num_blocks_ - used, level);
+    }
+}
+
+// Highest level w such that giving every tenant min(demand, w) fits in the
+// pool. Selects pivots with nth_element and keeps running sums of the
+// demands known to be below the level, so it runs in expected O(N).
+uint32_t MaxMinAllocator::get_water_level() {
+    size_t lo = 0, hi = scratch_.size();
+    uint64_t satisfied = 0, capped = 0;
+    while (lo < hi) {
+        STATS_ADD(MAXMIN_LEVEL_ROUNDS, 1);
+        size_t mid = lo + (hi - lo) / 2;
+        std::nth_element(scratch_.begin() + lo, scratch_.begin() + mid, scratch_.begin() + hi);
+        uint32_t pivot = scratch_[mid];
+
+        uint64_t below = 0;
+        for (size_t i = lo; i <= mid; ++i) {
+            below += scratch_[i];
+        }
+
+        if (satisfied + below + (hi - mid - 1 + capped) * pivot <= num_blocks_) {
+            satisfied += below;
+            lo = mid + 1;
+        } else {
+            capped += hi - mid;
+            hi = mid;
+        }
+    }
+
+    if (capped == 0) {
+        return std::numeric_limits<uint32_t>::max();
+    }
+    return (num_blocks_ - satisfied) / capped;
+}
+
+// Hands the blocks left below the next level out one at a time to the
+// unsaturated tenants with the smallest demands, larger slot first on ties
+void MaxMinAllocator::distribute_remainder(uint64_t remainder, uint32_t level) {
+    if (remainder == 0) {
+        return;
+    }
+    const auto& demands = tenants_.demands_;
+
+    scratch_.clear();
+    if (sparse_) {
+        for (uint32_t s : active_) {
+            if (demands[s] > level) {
+                scratch_.push_back(s);
+            }
+        }
+    } else {
+        for (uint32_t s = 0; s < tenants_.size(); ++s) {
+            if (demands[s] > level) {
+                scratch_.push_back(s);
+            }
+        }
+    }
+    assert(remainder < scratch_.size());
+
+    std::nth_element(scratch_.begin(), scratch_.begin() + remainder, scratch_.end(), [&](uint32_t a, uint32_t b) {
+        return demands[a] < demands[b] || (demands[a] == demands[b] && a > b);
+    });
+    for (size_t i = 0; i < remainder; ++i) {
+        tenants_.allocations_[scratch_[i]]++;
     }
 }
 
 void MaxMinAllocator::set_demand(uint32_t id, uint32_t demand, bool greedy) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("set_demand(): tenant ID does not exist");
     }
 
     if (greedy) {
         demand = std::max(get_fair_share(), demand);
     }
-    it->second.demand_ = demand;
+    tenants_.demands_[slot] = demand;
+    sparse_ = false;
+}
+
+void MaxMinAllocator::set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    if (demands.size() != get_num_tenants() || greedy.size() != get_num_tenants()) {
+        throw std::invalid_argument("set_demands(): expected one demand per tenant");
+    }
+    if (demands.empty()) {
+        return;
+    }
+
+    uint32_t fair_share = get_fair_share();
+    for (uint32_t s = 0; s < demands.size(); ++s) {
+        tenants_.demands_[s] = greedy[s] ? std::max(fair_share, demands[s]) : demands[s];
+    }
+    sparse_ = false;
+}
+
+// Positions are slots here
+void MaxMinAllocator::set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy) {
+    check_sparse_demands(demands, greedy);
+    auto& stored = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
+
+    if (!sparse_) {
+        std::fill(stored.begin(), stored.end(), 0);
+        std::fill(allocations.begin(), allocations.end(), 0);
+        sparse_ = true;
+    } else {
+        for (uint32_t s : active_) {
+            stored[s] = 0;
+            allocations[s] = 0;
+        }
+    }
+
+    uint32_t fair_share = get_fair_share();
+    active_ = demands.pos_;
+    for (size_t k = 0; k < active_.size(); ++k) {
+        uint32_t s = active_[k];
+        stored[s] = greedy[s] ? std::max(fair_share, demands.val_[k]) : demands.val_[k];
+    }
+}
+
+void MaxMinAllocator::get_sparse_allocations(SparseRow& allocations) {
+    allocations.pos_ = active_;
+    allocations.val_.resize(active_.size());
+    for (size_t k = 0; k < active_.size(); ++k) {
+        allocations.val_[k] = tenants_.allocations_[active_[k]];
+    }
 }
 
 uint32_t MaxMinAllocator::get_fair_share() {
@@ -85,9 +227,13 @@ uint32_t MaxMinAllocator::get_num_tenants() {
 }
 
 uint32_t MaxMinAllocator::get_allocation(uint32_t id) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_allocation(): tenant ID does not exist");
     }
-    return it->second.allocation_;
+    return tenants_.allocations_[slot];
 }
+
+void MaxMinAllocator::get_allocations(std::vector<uint32_t>& allocations) {
+    allocations = tenants_.allocations_;
+}
\ No newline at end of file
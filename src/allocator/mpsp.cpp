@@ -2,18 +2,19 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <queue>
 
 #include "utils.h"
 
+// Equal prices are ordered by slot so that the later tenant wins the tie
 bool bid_cmp(const pi& a, const pi& b) {
-    return a.second < b.second;
+    return a.second < b.second || (a.second == b.second && a.first < b.first);
 }
 
-void MPSPAllocator::Tenant::bid_auction(uint32_t demand, uint32_t fair_share,
-                                        bool greedy, pi border_bids) {
+void MPSPAllocator::bid_auction(uint32_t slot, uint32_t demand, uint32_t fair_share, bool greedy) {
     if (demand <= fair_share) {
-        bid_.qty_ = 0;
+        bids_[slot].qty_ = 0;
     } else {
         uint32_t qty = demand - fair_share;
         uint32_t val = valuation_(qty);
@@ -21,9 +22,9 @@ void MPSPAllocator::Tenant::bid_auction(uint32_t demand, uint32_t fair_share,
 
         if (greedy) {
             uint32_t delta = 10;
-            val += rand_uniform(-delta, delta);
+            val += rand_uniform(rng_, -delta, delta);
         }
-        bid_ = Bid(qty, val);
+        bids_[slot] = Bid(qty, val);
     }
 }
 
@@ -35,62 +36,67 @@ MPSPAllocator::MPSPAllocator(uint64_t num_blocks, uint64_t base_blocks, fi valua
     border_bids_.first = valuation(1);
     border_bids_.second = border_bids_.first;
 
-    tenants_[PUBLIC_ID].bid_ = Bid(get_free_blocks() + 1, border_bids_.first / 2);
+    tenants_.add(PUBLIC_ID);
+    bids_.emplace_back(get_free_blocks() + 1, border_bids_.first / 2);
+    payments_.push_back(0);
 }
 
 void MPSPAllocator::add_tenant(uint32_t id) {
-    if (id == PUBLIC_ID || tenants_.find(id) != tenants_.end()) {
+    if (id == PUBLIC_ID || tenants_.contains(id)) {
         throw std::out_of_range("add_tenant(): tenant ID already exists");
     }
-    tenants_.emplace(id, valuation_);
+    tenants_.add(id);
+    bids_.emplace_back();
+    payments_.push_back(0);
 }
 
 void MPSPAllocator::remove_tenant(uint32_t id) {
-    if (id == PUBLIC_ID || tenants_.find(id) == tenants_.end()) {
+    if (id == PUBLIC_ID || !tenants_.contains(id)) {
         throw std::out_of_range("remove_tenant(): tenant ID does not exist");
     }
-    tenants_.erase(id);
+    uint32_t slot = tenants_.remove(id);
+    erase_slot(bids_, slot);
+    erase_slot(payments_, slot);
 }
 
 void MPSPAllocator::allocate() {
     uint32_t fair_share = get_fair_share();
     uint32_t free_blocks = get_free_blocks();
     std::vector<pi> lowest_bids;
+    auto& allocations = tenants_.allocations_;
 
-    for (auto& [id, t] : tenants_) {
-        t.payment_ = 0;
-        if (id != PUBLIC_ID) {
-            t.allocation_ = fair_share;
-        } else {
-            t.bid_.qty_ = free_blocks + 1;
-        }
+    std::fill(payments_.begin(), payments_.end(), 0);
+    std::fill(allocations.begin() + PUBLIC_SLOT + 1, allocations.end(), fair_share);
+    bids_[PUBLIC_SLOT].qty_ = free_blocks + 1;
 
-        if (t.bid_.qty_ > 0) {
-            lowest_bids.emplace_back(id, t.bid_.price_);
+    {
+        STATS_PHASE(MPSP_SORT);
+        for (uint32_t s = 0; s < tenants_.size(); ++s) {
+            if (bids_[s].qty_ > 0) {
+                lowest_bids.emplace_back(s, bids_[s].price_);
+            }
         }
+        std::sort(lowest_bids.begin(), lowest_bids.end(), bid_cmp);
     }
 
-    std::sort(lowest_bids.begin(), lowest_bids.end(), bid_cmp);
-
-    uint64_t welfare = 0;
     // std::vector<uint32_t> winners;
     while (free_blocks > 0) {
-        auto [id, price] = lowest_bids.back();
-        auto& t = tenants_[id];
-        assert(t.payment_ == 0);
+        STATS_ADD(MPSP_WINNING_BIDS, 1);
+        auto [s, price] = lowest_bids.back();
+        auto& bid = bids_[s];
+        assert(payments_[s] == 0);
 
-        uint32_t blocks = std::min(t.bid_.qty_, free_blocks);
+        uint32_t blocks = std::min(bid.qty_, free_blocks);
         assert(blocks > 0);
 
-        t.bid_.qty_ -= blocks;
-        t.allocation_ = blocks;
-        t.payment_ = price;
+        bid.qty_ -= blocks;
+        allocations[s] = blocks;
+        payments_[s] = price;
 
         free_blocks -= blocks;
-        welfare += blocks * price;
         border_bids_.first = price;
 
-        if (t.bid_.qty_ == 0) {
+        if (bid.qty_ == 0) {
             lowest_bids.pop_back();
         }
         // winners.push_back(id);
@@ -100,43 +106,74 @@ void MPSPAllocator::allocate() {
     border_bids_.second = lowest_bids.back().second;
     assert(border_bids_.first >= border_bids_.second);
 
-    for (auto& [id, t] : tenants_) {
-        if (id != PUBLIC_ID) {
-            charge_exclusion_payment(id, lowest_bids, welfare);
-        }
-    }
+    STATS_PHASE(MPSP_PAYMENTS);
+    charge_exclusion_payments(lowest_bids);
 }
 
-void MPSPAllocator::charge_exclusion_payment(int id, std::vector<pi>& remaining_bids, uint64_t welfare) {
-    auto& t = tenants_[id];
-    if (t.payment_ > 0) {
-        uint32_t free_blocks = t.allocation_;
+void MPSPAllocator::build_bid_book(const std::vector<pi>& remaining_bids) {
+    book_qty_.assign(1, 0);
+    book_welfare_.assign(1, 0);
+    for (size_t i = remaining_bids.size(); i-- > 0;) {
+        auto [bidder, price] = remaining_bids[i];
+        uint32_t qty = bids_[bidder].qty_;
+        book_qty_.push_back(book_qty_.back() + qty);
+        book_welfare_.push_back(book_welfare_.back() + (uint32_t)(qty * price));
+    }
+}
 
-        uint64_t exclude_welfare = welfare - t.payment_ * t.allocation_;
-        welfare = exclude_welfare;
+// Welfare of refilling blocks from the highest remaining bids, leaving out
+// the first skip entries of the book
+uint64_t MPSPAllocator::get_exclusion_welfare(const std::vector<pi>& remaining_bids, size_t skip, uint32_t blocks) {
+    uint64_t target = book_qty_[skip] + blocks;
+    size_t k = std::upper_bound(book_qty_.begin() + skip, book_qty_.end(), target) - book_qty_.begin() - 1;
 
-        for (int i = remaining_bids.size() - 1; i >= 0 && free_blocks > 0; --i) {
-            auto [bidder_id, price] = remaining_bids[i];
+    uint64_t welfare = book_welfare_[k] - book_welfare_[skip];
+    if (k < remaining_bids.size()) {
+        uint32_t partial = target - book_qty_[k];
+        welfare += (uint32_t)(partial * remaining_bids[remaining_bids.size() - 1 - k].second);
+    }
+    return welfare;
+}
 
-            if (id != bidder_id) {
-                uint32_t blocks = std::min(tenants_[bidder_id].bid_.qty_, free_blocks);
-                free_blocks -= blocks;
-                welfare += blocks * price;
-            }
+// Each winner pays the welfare the remaining bids would have gained from its
+// blocks. Only the marginal winner can still be in the book, at its top.
+void MPSPAllocator::charge_exclusion_payments(const std::vector<pi>& remaining_bids) {
+    build_bid_book(remaining_bids);
+
+    for (uint32_t s = PUBLIC_SLOT + 1; s < tenants_.size(); ++s) {
+        uint32_t allocation = tenants_.allocations_[s];
+        if (payments_[s] > 0) {
+            size_t skip = remaining_bids.back().first == s ? 1 : 0;
+            uint32_t payment = get_exclusion_welfare(remaining_bids, skip, allocation) / allocation;
+            assert(payment > 0 && payment <= payments_[s]);
+            payments_[s] = payment;
         }
-
-        uint32_t payment = (welfare - exclude_welfare) / t.allocation_;
-        assert(payment > 0 && payment <= t.payment_);
-        t.payment_ = payment;
     }
 }
 
 void MPSPAllocator::set_demand(uint32_t id, uint32_t demand, bool greedy) {
-    auto it = tenants_.find(id);
-    if (id == PUBLIC_ID || it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (id == PUBLIC_ID || slot == NO_SLOT) {
         throw std::out_of_range("set_demand(): tenant ID does not exist");
     }
-    it->second.bid_auction(demand, get_fair_share(), greedy, border_bids_);
+    tenants_.demands_[slot] = demand;
+    bid_auction(slot, demand, get_fair_share(), greedy);
+}
+
+void MPSPAllocator::set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    if (demands.size() != get_num_tenants() || greedy.size() != get_num_tenants()) {
+        throw std::invalid_argument("set_demands(): expected one demand per tenant");
+    }
+    if (demands.empty()) {
+        return;
+    }
+
+    uint32_t fair_share = get_fair_share();
+    for (uint32_t k = 0; k < demands.size(); ++k) {
+        uint32_t slot = PUBLIC_SLOT + 1 + k;
+        tenants_.demands_[slot] = demands[k];
+        bid_auction(slot, demands[k], fair_share, greedy[k]);
+    }
 }
 
 uint32_t MPSPAllocator::get_num_tenants() {
@@ -144,19 +181,27 @@ uint32_t MPSPAllocator::get_num_tenants() {
 }
 
 uint32_t MPSPAllocator::get_allocation(uint32_t id) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_allocation(): tenant ID does not exist");
     }
-    return it->second.allocation_;
+    return tenants_.allocations_[slot];
+}
+
+void MPSPAllocator::get_allocations(std::vector<uint32_t>& allocations) {
+    allocations.assign(tenants_.allocations_.begin() + PUBLIC_SLOT + 1, tenants_.allocations_.end());
 }
 
 uint32_t MPSPAllocator::get_payment(uint32_t id) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_payment(): tenant ID does not exist");
     }
-    return it->second.payment_;
+    return payments_[slot];
+}
+
+void MPSPAllocator::get_payments(std::vector<uint32_t>& payments) {
+    payments.assign(payments_.begin() + PUBLIC_SLOT + 1, payments_.end());
 }
 
 fi MPSPAllocator::get_valuation() {
@@ -0,0 +1,61 @@
+#include "allocator/pool_manager.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+PoolManager::PoolManager(uint32_t num_threads) : workers_(std::max(num_threads, 1u)) {
+    allocate_pool_ = [this](size_t pool) {
+        pools_[pool]->allocate();
+    };
+}
+
+uint32_t PoolManager::add_pool(std::unique_ptr<Allocator> alloc) {
+    if (alloc == nullptr) {
+        throw std::invalid_argument("add_pool(): allocator must not be null");
+    }
+    pools_.push_back(std::move(alloc));
+    return pools_.size() - 1;
+}
+
+Allocator& PoolManager::get_pool(uint32_t pool) {
+    if (pool >= pools_.size()) {
+        throw std::out_of_range("get_pool(): pool ID does not exist");
+    }
+    return *pools_[pool];
+}
+
+uint32_t PoolManager::get_num_pools() {
+    return pools_.size();
+}
+
+uint32_t PoolManager::get_num_threads() {
+    return workers_.get_num_threads();
+}
+
+void PoolManager::add_tenant(uint32_t pool, uint32_t id) {
+    get_pool(pool).add_tenant(id);
+}
+
+void PoolManager::remove_tenant(uint32_t pool, uint32_t id) {
+    get_pool(pool).remove_tenant(id);
+}
+
+void PoolManager::set_demand(uint32_t pool, uint32_t id, uint32_t demand, bool greedy) {
+    get_pool(pool).set_demand(id, demand, greedy);
+}
+
+void PoolManager::set_demands(uint32_t pool, const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    get_pool(pool).set_demands(demands, greedy);
+}
+
+void PoolManager::allocate() {
+    workers_.run(pools_.size(), allocate_pool_);
+}
+
+uint32_t PoolManager::get_allocation(uint32_t pool, uint32_t id) {
+    return get_pool(pool).get_allocation(id);
+}
+
+void PoolManager::get_allocations(uint32_t pool, std::vector<uint32_t>& allocations) {
+    get_pool(pool).get_allocations(allocations);
+}
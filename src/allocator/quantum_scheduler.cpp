@@ -0,0 +1,183 @@
+#include "allocator/quantum_scheduler.h"
+
+#include <stdexcept>
+
+QuantumScheduler::QuantumScheduler(Allocator& alloc, uint32_t capacity, std::chrono::microseconds quantum)
+    : alloc_(alloc), inbox_(capacity), quantum_(quantum) {
+    if (quantum.count() <= 0) {
+        throw std::invalid_argument("quantum must be positive");
+    }
+    if (alloc.get_num_tenants() != 0) {
+        throw std::invalid_argument("allocator must start without tenants");
+    }
+
+    uint32_t table_size = inbox_.get_table_size();
+    position_of_.assign(table_size, NO_SLOT);
+    for (auto& buffer : buffers_) {
+        buffer = std::make_unique<std::atomic<uint32_t>[]>(table_size);
+        for (uint32_t i = 0; i < table_size; ++i) {
+            buffer[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+QuantumScheduler::~QuantumScheduler() {
+    stop();
+}
+
+void QuantumScheduler::start() {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    if (timer_.joinable()) {
+        return;
+    }
+    stopping_ = false;
+    timer_ = std::thread(&QuantumScheduler::run_timer, this);
+}
+
+void QuantumScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        stopping_ = true;
+    }
+    timer_cv_.notify_all();
+    if (timer_.joinable()) {
+        timer_.join();
+    }
+}
+
+void QuantumScheduler::run_timer() {
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(timer_mutex_);
+    while (true) {
+        next += quantum_;
+        if (timer_cv_.wait_until(lock, next, [this]() { return stopping_; })) {
+            break;
+        }
+
+        lock.unlock();
+        run_quantum();
+        lock.lock();
+
+        // Skip the ticks a slow quantum ran over instead of bunching them up
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next + quantum_) {
+            overruns_.fetch_add(1, std::memory_order_relaxed);
+            next = now;
+        }
+    }
+}
+
+void QuantumScheduler::add_tenant(uint32_t id) {
+    if (id == PUBLIC_ID) {
+        throw std::out_of_range("add_tenant(): tenant ID already exists");
+    }
+
+    // The inbox rejects duplicates and a full table before the allocator
+    // sees the tenant, so the two never disagree
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    inbox_.add_tenant(id);
+    alloc_.add_tenant(id);
+
+    uint32_t slot = inbox_.find_slot(id);
+    position_of_[slot] = positions_.size();
+    positions_.push_back(slot);
+    for (auto& buffer : buffers_) {
+        buffer[slot].store(0, std::memory_order_relaxed);
+    }
+}
+
+void QuantumScheduler::remove_tenant(uint32_t id) {
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    uint32_t slot = inbox_.find_slot(id);
+    alloc_.remove_tenant(id);
+    inbox_.remove_tenant(id);
+
+    // Mirror the allocator: the last position moves into the freed one
+    uint32_t pos = position_of_[slot];
+    positions_[pos] = positions_.back();
+    position_of_[positions_[pos]] = pos;
+    positions_.pop_back();
+    position_of_[slot] = NO_SLOT;
+}
+
+void QuantumScheduler::set_demand(uint32_t id, uint32_t demand, bool greedy) {
+    inbox_.set_demand(id, demand, greedy);
+}
+
+void QuantumScheduler::run_quantum() {
+    std::lock_guard<std::mutex> lock(alloc_mutex_);
+    inbox_.drain(alloc_);
+    if (!positions_.empty()) {
+        alloc_.allocate();
+    }
+    alloc_.get_allocations(allocations_);
+    publish();
+}
+
+void QuantumScheduler::publish() {
+    uint64_t q = published_.load(std::memory_order_relaxed) + 1;
+    writing_.store(q, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& buffer = buffers_[q & 1];
+    for (uint32_t pos = 0; pos < positions_.size(); ++pos) {
+        buffer[positions_[pos]].store(allocations_[pos], std::memory_order_relaxed);
+    }
+    published_.store(q, std::memory_order_release);
+}
+
+// Quantum q + 2 is the first to overwrite quantum q's buffer, so a read of
+// quantum q is consistent as long as that write had not started when the
+// read finished.
+template <typename F>
+uint64_t QuantumScheduler::read_snapshot(F&& read) const {
+    while (true) {
+        uint64_t q = published_.load(std::memory_order_acquire);
+        read(buffers_[q & 1].get());
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (writing_.load(std::memory_order_relaxed) <= q + 1) {
+            return q;
+        }
+    }
+}
+
+uint32_t QuantumScheduler::get_allocation(uint32_t id) const {
+    uint32_t slot = inbox_.find_slot(id);
+    if (slot == NO_SLOT) {
+        throw std::out_of_range("get_allocation(): tenant ID does not exist");
+    }
+
+    uint32_t allocation;
+    read_snapshot([&](const std::atomic<uint32_t>* buffer) {
+        allocation = buffer[slot].load(std::memory_order_relaxed);
+    });
+    return allocation;
+}
+
+uint64_t QuantumScheduler::get_allocations(const std::vector<uint32_t>& ids, std::vector<uint32_t>& allocations) const {
+    allocations.resize(ids.size());
+    uint64_t q = get_allocations(ids.data(), ids.size(), allocations.data());
+    for (uint32_t allocation : allocations) {
+        if (allocation == NO_SLOT) {
+            throw std::out_of_range("get_allocations(): tenant ID does not exist");
+        }
+    }
+    return q;
+}
+
+uint64_t QuantumScheduler::get_allocations(const uint32_t* ids, size_t count, uint32_t* allocations) const {
+    return read_snapshot([&](const std::atomic<uint32_t>* buffer) {
+        for (size_t k = 0; k < count; ++k) {
+            uint32_t slot = inbox_.find_slot(ids[k]);
+            allocations[k] = slot == NO_SLOT ? NO_SLOT : buffer[slot].load(std::memory_order_relaxed);
+        }
+    });
+}
+
+uint64_t QuantumScheduler::get_num_quanta() const {
+    return published_.load(std::memory_order_acquire);
+}
+
+uint64_t QuantumScheduler::get_num_overruns() const {
+    return overruns_.load(std::memory_order_relaxed);
+}
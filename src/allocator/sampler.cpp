@@ -0,0 +1,62 @@
+#include "allocator/sampler.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include "utils.h"
+
+WeightedSampler::WeightedSampler(const std::vector<uint32_t>& weights) {
+    leaves_ = 1;
+    while (leaves_ < weights.size()) {
+        leaves_ *= 2;
+    }
+
+    tree_.assign(2 * leaves_, 0);
+    std::copy(weights.begin(), weights.end(), tree_.begin() + leaves_);
+    for (size_t node = leaves_ - 1; node > 0; --node) {
+        tree_[node] = tree_[2 * node] + tree_[2 * node + 1];
+    }
+}
+
+void WeightedSampler::set_weight(uint32_t idx, uint32_t weight) {
+    size_t node = leaves_ + idx;
+    tree_[node] = weight;
+    for (node /= 2; node > 0; node /= 2) {
+        tree_[node] = tree_[2 * node] + tree_[2 * node + 1];
+    }
+}
+
+uint64_t WeightedSampler::get_total_weight() {
+    return tree_[1];
+}
+
+// Adds the number of draws landing on each index to counts, and appends every
+// index drawn at least once to hits
+void WeightedSampler::sample(Philox& rng, uint64_t n, std::vector<uint32_t>& counts, std::vector<uint32_t>& hits) {
+    assert(n == 0 || get_total_weight() > 0);
+
+    std::vector<std::pair<size_t, uint64_t>> stack;
+    if (n > 0) {
+        stack.emplace_back(1, n);
+    }
+
+    while (!stack.empty()) {
+        auto [node, draws] = stack.back();
+        stack.pop_back();
+
+        if (node >= leaves_) {
+            counts[node - leaves_] += draws;
+            hits.push_back(node - leaves_);
+            continue;
+        }
+
+        uint64_t left = sample_rand_binomial(rng, draws, (double)tree_[2 * node] / tree_[node]);
+        if (left > 0) {
+            stack.emplace_back(2 * node, left);
+        }
+        if (draws > left) {
+            stack.emplace_back(2 * node + 1, draws - left);
+        }
+    }
+}
@@ -1,37 +1,59 @@
 #include "allocator/sharp.h"
 
+#include <algorithm>
+
+#include "allocator/sampler.h"
 #include "utils.h"
 
-void SharpAllocator::Tenant::grant_claim(Claim claim) {
-    num_tickets_ += claim.blocks_;
-    claims_.push_back(claim);
+void SharpAllocator::grant_claim(uint32_t slot, uint32_t blocks) {
+    tickets_[slot] += blocks;
+    if (blocks > 0) {
+        claims_[slot].emplace_back(blocks, quantum_ + claim_term_ - 1);
+    }
 }
 
-uint32_t SharpAllocator::Tenant::expire_claims() {
-    uint32_t expired_blocks = 0;
-    uint32_t alloc = allocation_;
-    for (auto it = claims_.begin(); it != claims_.end();) {
-        if (alloc) {
-            uint32_t redeemed = std::min(alloc, it->blocks_);
-            it->blocks_ -= redeemed;
-            alloc -= redeemed;
+uint32_t SharpAllocator::expire_claims(uint32_t slot) {
+    auto& claims = claims_[slot];
+    uint32_t& head = claim_head_[slot];
+
+    // Redeem from the oldest claims first; allocations never exceed tickets,
+    // so this stops within the live claims
+    uint32_t alloc = tenants_.allocations_[slot];
+    while (alloc) {
+        assert(head < claims.size());
+        Claim& claim = claims[head];
+        uint32_t redeemed = std::min(alloc, claim.blocks_);
+        claim.blocks_ -= redeemed;
+        alloc -= redeemed;
+        if (claim.blocks_ == 0) {
+            head++;
         }
+    }
 
-        if (it->blocks_ && --it->term_) {
-            ++it;
-        } else {
-            expired_blocks += it->blocks_;
-            it = claims_.erase(it);
-        }
+    uint32_t expired_blocks = 0;
+    if (head < claims.size() && claims[head].expiry_ == quantum_) {
+        expired_blocks = claims[head].blocks_;
+        head++;
     }
 
-    uint32_t lost_tickets = allocation_ + expired_blocks;
-    num_tickets_ -= lost_tickets;
+    if (head == claims.size()) {
+        claims.clear();
+        head = 0;
+    } else if (head >= 16 && 2 * head >= claims.size()) {
+        claims.erase(claims.begin(), claims.begin() + head);
+        head = 0;
+    }
+
+    uint32_t lost_tickets = tenants_.allocations_[slot] + expired_blocks;
+    tickets_[slot] -= lost_tickets;
     return lost_tickets;
 }
 
 SharpAllocator::SharpAllocator(uint64_t num_blocks, float OD, uint32_t claim_term)
     : Allocator(num_blocks), claim_alloc_(num_blocks), claim_term_(claim_term) {
+    if (claim_term == 0) {
+        throw std::invalid_argument("claim term must be at least one quantum");
+    }
     if (OD < 1) {
         std::cout << "warning: oversubscription degree less than 1" << std::endl;
     }
@@ -39,81 +61,130 @@ SharpAllocator::SharpAllocator(uint64_t num_blocks, float OD, uint32_t claim_ter
 }
 
 void SharpAllocator::add_tenant(uint32_t id) {
-    if (id == PUBLIC_ID || tenants_.find(id) != tenants_.end()) {
+    if (id == PUBLIC_ID || tenants_.contains(id)) {
         throw std::out_of_range("add_tenant(): tenant ID already exists");
     }
-    tenants_[id] = Tenant();
+    tenants_.add(id);
+    tickets_.push_back(0);
+    claims_.emplace_back();
+    claim_head_.push_back(0);
     claim_alloc_.add_tenant(id);
 }
 
 void SharpAllocator::remove_tenant(uint32_t id) {
-    if (id == PUBLIC_ID || tenants_.find(id) == tenants_.end()) {
+    if (id == PUBLIC_ID || !tenants_.contains(id)) {
         throw std::out_of_range("remove_tenant(): tenant ID does not exist");
     }
-    tenants_.erase(id);
+    uint32_t slot = tenants_.remove(id);
+    erase_slot(tickets_, slot);
+    erase_slot(claims_, slot);
+    erase_slot(claim_head_, slot);
     claim_alloc_.remove_tenant(id);
 }
 
 void SharpAllocator::allocate() {
-    delegate_claims();
-    redeem_claims();
-    expire_claims();
+    {
+        STATS_PHASE(SHARP_DELEGATE);
+        delegate_claims();
+    }
+    {
+        STATS_PHASE(SHARP_REDEEM);
+        redeem_claims();
+    }
+    {
+        STATS_PHASE(SHARP_EXPIRE);
+        expire_claims();
+    }
+    quantum_++;
 }
 
 void SharpAllocator::set_demand(uint32_t id, uint32_t demand, bool greedy) {
-    auto it = tenants_.find(id);
-    if (id == PUBLIC_ID || it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (id == PUBLIC_ID || slot == NO_SLOT) {
         throw std::out_of_range("set_demand(): tenant ID does not exist");
     }
 
     if (greedy) {
         demand = std::max(get_fair_share(), demand);
     }
-    it->second.demand_ = demand;
+    tenants_.demands_[slot] = demand;
     claim_alloc_.set_demand(id, demand, greedy);
 }
 
+void SharpAllocator::set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    if (demands.size() != get_num_tenants() || greedy.size() != get_num_tenants()) {
+        throw std::invalid_argument("set_demands(): expected one demand per tenant");
+    }
+    if (demands.empty()) {
+        return;
+    }
+
+    uint32_t fair_share = get_fair_share();
+    for (uint32_t s = 0; s < demands.size(); ++s) {
+        tenants_.demands_[s] = greedy[s] ? std::max(fair_share, demands[s]) : demands[s];
+    }
+    claim_alloc_.set_demands(tenants_.demands_, greedy);
+}
+
 void SharpAllocator::delegate_claims() {
     claim_alloc_.allocate();
 
+    // claim_alloc_ gains and loses tenants in step with tenants_, so its
+    // positions line up with our slots
+    std::vector<uint32_t> tickets;
+    claim_alloc_.get_allocations(tickets);
+
     uint64_t total_tickets = 0;
-    for (auto& [id, t] : tenants_) {
-        uint32_t tickets = claim_alloc_.get_allocation(id);
-        t.grant_claim(Claim(tickets, claim_term_));
-        total_tickets += tickets;
+    for (uint32_t s = 0; s < tenants_.size(); ++s) {
+        grant_claim(s, tickets[s]);
+        total_tickets += tickets[s];
     }
     claim_alloc_.add_num_blocks(-total_tickets);
 }
 
 void SharpAllocator::redeem_claims() {
+    const auto& demands = tenants_.demands_;
+    auto& allocations = tenants_.allocations_;
+
     uint64_t total_redeeem = 0;
-    for (auto& [_, t] : tenants_) {
-        total_redeeem += std::min(t.demand_, t.num_tickets_);
+    for (uint32_t s = 0; s < tenants_.size(); ++s) {
+        total_redeeem += std::min(demands[s], tickets_[s]);
     }
 
     if (total_redeeem <= num_blocks_) {
-        for (auto& [_, t] : tenants_) {
-            t.allocation_ = std::min(t.demand_, t.num_tickets_);
+        for (uint32_t s = 0; s < tenants_.size(); ++s) {
+            allocations[s] = std::min(demands[s], tickets_[s]);
         }
     } else {
         std::vector<uint32_t> weights(get_num_tenants(), 0);
-        // Assume tenant IDs are in [1, N]
-        for (auto& [id, t] : tenants_) {
-            t.allocation_ = 0;
-            if (t.demand_ > 0) {
-                weights[id - 1] = t.num_tickets_;
+        for (uint32_t s = 0; s < tenants_.size(); ++s) {
+            allocations[s] = 0;
+            if (demands[s] > 0) {
+                weights[s] = tickets_[s];
             }
         }
-        auto dist = get_rand_discrete(weights);
-
-        for (uint32_t i = 0; i < num_blocks_; ++i) {
-            uint32_t id = sample_rand_discrete(dist) + 1;
-            auto& t = tenants_[id];
-
-            assert(t.allocation_ < t.demand_ && t.allocation_ < t.num_tickets_);
-            if (++t.allocation_ == std::min(t.demand_, t.num_tickets_)) {
-                weights[id - 1] = 0;
-                dist = get_rand_discrete(weights);
+        WeightedSampler lottery(weights);
+
+        // Drawing blocks one at a time and dropping tenants as they saturate is
+        // the same as drawing from the full lottery and discarding draws for
+        // saturated tenants. Each round draws all undecided blocks as one batch
+        // and returns the draws past a tenant's cap to the next round.
+        std::vector<uint32_t> hits;
+        uint64_t undecided = num_blocks_;
+        while (undecided > 0) {
+            STATS_ADD(SHARP_LOTTERY_ROUNDS, 1);
+            STATS_ADD(SHARP_LOTTERY_DRAWS, undecided);
+            hits.clear();
+            lottery.sample(rng_, undecided, allocations, hits);
+
+            undecided = 0;
+            for (uint32_t s : hits) {
+                uint32_t cap = std::min(demands[s], tickets_[s]);
+                if (allocations[s] >= cap) {
+                    undecided += allocations[s] - cap;
+                    allocations[s] = cap;
+                    lottery.set_weight(s, 0);
+                }
             }
         }
     }
@@ -121,8 +192,8 @@ void SharpAllocator::redeem_claims() {
 
 void SharpAllocator::expire_claims() {
     uint64_t recovered_tickets = 0;
-    for (auto& [_, t] : tenants_) {
-        recovered_tickets += t.expire_claims();
+    for (uint32_t s = 0; s < tenants_.size(); ++s) {
+        recovered_tickets += expire_claims(s);
     }
     claim_alloc_.add_num_blocks(recovered_tickets);
 }
@@ -136,19 +207,27 @@ uint32_t SharpAllocator::get_num_tenants() {
 }
 
 uint32_t SharpAllocator::get_allocation(uint32_t id) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_allocation(): tenant ID does not exist");
     }
-    return it->second.allocation_;
+    return tenants_.allocations_[slot];
+}
+
+void SharpAllocator::get_allocations(std::vector<uint32_t>& allocations) {
+    allocations = tenants_.allocations_;
 }
 
 uint32_t SharpAllocator::get_tickets(uint32_t id) {
-    auto it = tenants_.find(id);
-    if (it == tenants_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_allocation(): tenant ID does not exist");
     }
-    return it->second.num_tickets_;
+    return tickets_[slot];
+}
+
+void SharpAllocator::get_tickets(std::vector<uint32_t>& tickets) {
+    tickets = tickets_;
 }
 
 uint64_t SharpAllocator::get_available_tickets() {
@@ -1,47 +1,73 @@
 #include "allocator/static.h"
 
+#include <algorithm>
+
 StaticAllocator::StaticAllocator(uint64_t num_blocks) : Allocator(num_blocks) {
 }
 
 void StaticAllocator::add_tenant(uint32_t id) {
-    if (allocations_.find(id) != allocations_.end()) {
+    if (tenants_.contains(id)) {
         throw std::out_of_range("add_tenant(): tenant ID already exists");
     }
-    allocations_[id] = 0;
+    tenants_.add(id);
+    stale_ = true;
 }
 
 void StaticAllocator::remove_tenant(uint32_t id) {
-    if (allocations_.find(id) == allocations_.end()) {
+    if (!tenants_.contains(id)) {
         throw std::out_of_range("remove_tenant(): tenant ID does not exist");
     }
-    allocations_.erase(id);
+    tenants_.remove(id);
+    stale_ = true;
 }
 
 void StaticAllocator::allocate() {
     uint32_t fair_share = get_fair_share();
-    for (auto& a : allocations_) {
-        a.second = fair_share;
+    if (stale_ || fair_share != filled_share_) {
+        std::fill(tenants_.allocations_.begin(), tenants_.allocations_.end(), fair_share);
+        filled_share_ = fair_share;
+        stale_ = false;
     }
 }
 
 void StaticAllocator::set_demand(uint32_t id, uint32_t demand, bool greedy) {
-    if (allocations_.find(id) == allocations_.end()) {
+    if (!tenants_.contains(id)) {
         throw std::out_of_range("set_demand(): tenant ID does not exist");
     }
 }
 
+void StaticAllocator::set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    if (demands.size() != get_num_tenants() || greedy.size() != get_num_tenants()) {
+        throw std::invalid_argument("set_demands(): expected one demand per tenant");
+    }
+}
+
+void StaticAllocator::set_sparse_demands(const SparseRow& demands, const std::vector<bool>& greedy) {
+    check_sparse_demands(demands, greedy);
+    listed_ = demands.pos_;
+}
+
+void StaticAllocator::get_sparse_allocations(SparseRow& allocations) {
+    allocations.pos_ = listed_;
+    allocations.val_.assign(listed_.size(), get_fair_share());
+}
+
 uint32_t StaticAllocator::get_fair_share() {
     return num_blocks_ / get_num_tenants();
 }
 
 uint32_t StaticAllocator::get_num_tenants() {
-    return allocations_.size();
+    return tenants_.size();
 }
 
 uint32_t StaticAllocator::get_allocation(uint32_t id) {
-    auto it = allocations_.find(id);
-    if (it == allocations_.end()) {
+    uint32_t slot = tenants_.find(id);
+    if (slot == NO_SLOT) {
         throw std::out_of_range("get_allocation(): tenant ID does not exist");
     }
-    return it->second;
+    return tenants_.allocations_[slot];
 }
+
+void StaticAllocator::get_allocations(std::vector<uint32_t>& allocations) {
+    allocations = tenants_.allocations_;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "allocator/stats.h"
+
+#include <algorithm>
+
+static const char* PHASE_NAMES[] = {"karma.classify", "karma.credits", "karma.sort",     "karma.exchange",
+                                    "maxmin.level",   "maxmin.fill",   "mpsp.sort",      "mpsp.payments",
+                                    "sharp.delegate", "sharp.redeem",  "sharp.expire"};
+
+static const char* COUNTER_NAMES[] = {"karma.changed_tenants", "karma.exchange_rounds", "karma.heap_pushes",
+                                      "karma.heap_pops",       "maxmin.level_rounds",   "mpsp.winning_bids",
+                                      "sharp.lottery_rounds",  "sharp.lottery_draws"};
+
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == AllocStats::NUM_PHASES);
+static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == AllocStats::NUM_COUNTERS);
+
+void AllocStats::clear() {
+    std::fill(std::begin(cycles_), std::end(cycles_), 0);
+    std::fill(std::begin(calls_), std::end(calls_), 0);
+    std::fill(std::begin(counters_), std::end(counters_), 0);
+}
+
+alloc_stats AllocStats::to_map() const {
+    alloc_stats stats;
+    for (size_t p = 0; p < NUM_PHASES; ++p) {
+        if (calls_[p] > 0) {
+            stats[std::string(PHASE_NAMES[p]) + ".cycles"] = cycles_[p];
+            stats[std::string(PHASE_NAMES[p]) + ".calls"] = calls_[p];
+        }
+    }
+    for (size_t c = 0; c < NUM_COUNTERS; ++c) {
+        if (counters_[c] > 0) {
+            stats[COUNTER_NAMES[c]] = counters_[c];
+        }
+    }
+    return stats;
+}
+
+#ifdef ALLOC_STATS
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+#endif
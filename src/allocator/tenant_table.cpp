@@ -0,0 +1,52 @@
+#include "allocator/tenant_table.h"
+
+TenantTable::TenantTable() {
+}
+
+uint32_t TenantTable::add(uint32_t id) {
+    assert(!contains(id));
+    uint32_t slot = ids_.size();
+
+    slots_.emplace(id, slot);
+    ids_.push_back(id);
+    demands_.push_back(0);
+    allocations_.push_back(0);
+    return slot;
+}
+
+uint32_t TenantTable::remove(uint32_t id) {
+    auto it = slots_.find(id);
+    assert(it != slots_.end());
+
+    uint32_t slot = it->second;
+    slots_.erase(it);
+    if (slot + 1 < ids_.size()) {
+        slots_[ids_.back()] = slot;
+    }
+
+    erase_slot(ids_, slot);
+    erase_slot(demands_, slot);
+    erase_slot(allocations_, slot);
+    return slot;
+}
+
+uint32_t TenantTable::find(uint32_t id) const {
+    auto it = slots_.find(id);
+    return it != slots_.end() ? it->second : NO_SLOT;
+}
+
+bool TenantTable::contains(uint32_t id) const {
+    return slots_.find(id) != slots_.end();
+}
+
+uint32_t TenantTable::size() const {
+    return ids_.size();
+}
+
+uint32_t TenantTable::id(uint32_t slot) const {
+    return ids_[slot];
+}
+
+const std::vector<uint32_t>& TenantTable::ids() const {
+    return ids_;
+}
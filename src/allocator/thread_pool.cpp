@@ -0,0 +1,120 @@
+#include "allocator/thread_pool.h"
+
+#include <stdexcept>
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+    if (num_threads == 0) {
+        throw std::invalid_argument("number of threads must be > 0");
+    }
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        queues_.push_back(std::make_unique<TaskQueue>());
+    }
+    for (uint32_t i = 1; i < num_threads; ++i) {
+        threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+uint32_t ThreadPool::get_num_threads() {
+    return queues_.size();
+}
+
+void ThreadPool::run(size_t num_tasks, const std::function<void(size_t)>& task) {
+    if (num_tasks == 0) {
+        return;
+    }
+
+    {
+        // Workers still finishing an earlier batch hold its task, so wait for
+        // them before handing out new indices
+        std::unique_lock<std::mutex> lock(m_);
+        done_cv_.wait(lock, [&] { return active_ == 0; });
+
+        for (size_t i = 0; i < num_tasks; ++i) {
+            auto& q = *queues_[i % queues_.size()];
+            std::lock_guard<std::mutex> qlock(q.m_);
+            q.tasks_.push_back(i);
+        }
+        task_ = &task;
+        pending_ = num_tasks;
+        generation_++;
+    }
+    start_cv_.notify_all();
+
+    drain(0, task);
+
+    std::unique_lock<std::mutex> lock(m_);
+    done_cv_.wait(lock, [&] { return pending_ == 0; });
+    task_ = nullptr;
+}
+
+void ThreadPool::worker_loop(uint32_t idx) {
+    uint64_t seen = 0;
+    while (true) {
+        const std::function<void(size_t)>* task;
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            start_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            task = task_;
+            active_++;
+        }
+
+        if (task != nullptr) {
+            drain(idx, *task);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            active_--;
+        }
+        done_cv_.notify_all();
+    }
+}
+
+void ThreadPool::drain(uint32_t idx, const std::function<void(size_t)>& task) {
+    size_t i;
+    while (next_task(idx, i)) {
+        task(i);
+        if (--pending_ == 0) {
+            std::lock_guard<std::mutex> lock(m_);
+            done_cv_.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::next_task(uint32_t idx, size_t& task) {
+    {
+        auto& own = *queues_[idx];
+        std::lock_guard<std::mutex> lock(own.m_);
+        if (!own.tasks_.empty()) {
+            task = own.tasks_.back();
+            own.tasks_.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t k = 1; k < queues_.size(); ++k) {
+        auto& victim = *queues_[(idx + k) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.m_);
+        if (!victim.tasks_.empty()) {
+            task = victim.tasks_.front();
+            victim.tasks_.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,107 @@
+#include "client.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ios>
+#include <stdexcept>
+
+AllocClient::AllocClient(const std::string& socket_path) {
+    sockaddr_un addr = {};
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("socket path is too long");
+    }
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0 || connect(fd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+        throw std::ios_base::failure("failed to connect to allocation server");
+    }
+}
+
+AllocClient::~AllocClient() {
+    close(fd_);
+}
+
+uint32_t AllocClient::add_tenants(const std::vector<uint32_t>& ids) {
+    send_request(MSG_ADD_TENANTS, ids.data(), ids.size());
+    return recv_ack();
+}
+
+uint32_t AllocClient::remove_tenants(const std::vector<uint32_t>& ids) {
+    send_request(MSG_REMOVE_TENANTS, ids.data(), ids.size());
+    return recv_ack();
+}
+
+uint32_t AllocClient::set_demands(const std::vector<DemandUpdate>& updates) {
+    send_request(MSG_SET_DEMANDS, updates.data(), updates.size());
+    return recv_ack();
+}
+
+uint64_t AllocClient::get_allocations(const std::vector<uint32_t>& ids, std::vector<uint32_t>& allocations) {
+    send_request(MSG_GET_ALLOCATIONS, ids.data(), ids.size());
+
+    MsgHeader reply;
+    uint64_t quantum;
+    recv_all(&reply, sizeof(reply));
+    if (reply.type_ != MSG_GET_ALLOCATIONS || reply.count_ != ids.size()) {
+        throw std::ios_base::failure("unexpected reply from allocation server");
+    }
+    recv_all(&quantum, sizeof(quantum));
+    allocations.resize(reply.count_);
+    recv_all(allocations.data(), reply.count_ * sizeof(uint32_t));
+    return quantum;
+}
+
+void AllocClient::send_request(uint32_t type, const void* records, uint32_t count) {
+    if (record_size(type) == 0 || count > MSG_MAX_RECORDS) {
+        throw std::invalid_argument("send_request(): malformed request");
+    }
+    MsgHeader header;
+    header.type_ = type;
+    header.count_ = count;
+    send_all(&header, sizeof(header));
+    send_all(records, (size_t)count * record_size(type));
+}
+
+uint32_t AllocClient::recv_ack() {
+    MsgHeader reply;
+    recv_all(&reply, sizeof(reply));
+    if (reply.type_ == MSG_GET_ALLOCATIONS || record_size(reply.type_) == 0) {
+        throw std::ios_base::failure("unexpected reply from allocation server");
+    }
+    return reply.count_;
+}
+
+void AllocClient::send_all(const void* data, size_t len) {
+    const char* p = (const char*)data;
+    while (len > 0) {
+        ssize_t n = send(fd_, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            throw std::ios_base::failure("lost connection to allocation server");
+        }
+        p += n, len -= n;
+    }
+}
+
+void AllocClient::recv_all(void* data, size_t len) {
+    char* p = (char*)data;
+    while (len > 0) {
+        ssize_t n = recv(fd_, p, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            throw std::ios_base::failure("lost connection to allocation server");
+        }
+        p += n, len -= n;
+    }
+}
@@ -0,0 +1,136 @@
+#include "demand_source.h"
+
+#include <ios>
+#include <stdexcept>
+
+bool DemandSource::next_sparse(SparseRow& demands) {
+    if (!next(dense_)) {
+        return false;
+    }
+    demands.assign(dense_);
+    return true;
+}
+
+TextDemandSource::TextDemandSource(const std::string& filename, uint32_t N, uint64_t T)
+    : DemandSource(N, T), file_(filename) {
+    if (!file_) {
+        throw std::ios_base::failure("failed to open demands file");
+    }
+}
+
+bool TextDemandSource::next(std::vector<uint32_t>& demands) {
+    if (t_ == T_) {
+        return false;
+    }
+    demands.resize(N_);
+    for (uint32_t i = 0; i < N_; ++i) {
+        file_ >> demands[i];
+    }
+    if (!file_) {
+        throw std::ios_base::failure("demands file ended before N x T values");
+    }
+    t_++;
+    return true;
+}
+
+void TextDemandSource::reset() {
+    file_.clear();
+    file_.seekg(0);
+    t_ = 0;
+}
+
+TraceDemandSource::TraceDemandSource(const std::string& filename, uint32_t N, uint64_t T)
+    : DemandSource(N, T), trace_(filename) {
+    if (trace_.get_num_tenants() < N || trace_.get_num_quanta() < T) {
+        throw std::invalid_argument("TraceDemandSource(): trace is smaller than N x T");
+    }
+}
+
+bool TraceDemandSource::next(std::vector<uint32_t>& demands) {
+    if (t_ == T_) {
+        return false;
+    }
+    auto row = trace_.row(t_++);
+    if (row.size() == N_) {
+        row.copy_to(demands);
+    } else {
+        demands.resize(N_);
+        for (uint32_t i = 0; i < N_; ++i) {
+            demands[i] = row[i];
+        }
+    }
+    return true;
+}
+
+void TraceDemandSource::reset() {
+    t_ = 0;
+}
+
+DeltaTraceDemandSource::DeltaTraceDemandSource(const std::string& filename, uint32_t N, uint64_t T)
+    : DemandSource(N, T), trace_(filename), reader_(trace_) {
+    if (trace_.get_num_tenants() < N || trace_.get_num_quanta() < T) {
+        throw std::invalid_argument("DeltaTraceDemandSource(): trace is smaller than N x T");
+    }
+}
+
+bool DeltaTraceDemandSource::next(std::vector<uint32_t>& demands) {
+    if (t_ == T_) {
+        return false;
+    }
+    reader_.next(demands);
+    demands.resize(N_);
+    t_++;
+    return true;
+}
+
+void DeltaTraceDemandSource::reset() {
+    reader_.seek(0);
+    t_ = 0;
+}
+
+UniformDemandSource::UniformDemandSource(uint32_t N, uint64_t T, uint32_t max_demand, uint64_t seed, uint64_t stream)
+    : DemandSource(N, T), seed_(seed), stream_(stream), gen_(seed, stream), dist_(0, max_demand) {
+}
+
+bool UniformDemandSource::next(std::vector<uint32_t>& demands) {
+    if (t_ == T_) {
+        return false;
+    }
+    demands.resize(N_);
+    for (uint32_t i = 0; i < N_; ++i) {
+        demands[i] = dist_(gen_);
+    }
+    t_++;
+    return true;
+}
+
+void UniformDemandSource::reset() {
+    gen_.seed(seed_, stream_);
+    dist_.reset();
+    t_ = 0;
+}
+
+MatrixDemandSource::MatrixDemandSource(const matrix& demands)
+    : DemandSource(demands.empty() ? 0 : demands[0].size(), demands.size()), demands_(demands) {
+}
+
+bool MatrixDemandSource::next(std::vector<uint32_t>& demands) {
+    if (t_ == T_) {
+        return false;
+    }
+    demands = demands_[t_++];
+    return true;
+}
+
+void MatrixDemandSource::reset() {
+    t_ = 0;
+}
+
+std::unique_ptr<DemandSource> open_demand_source(const std::string& filename, uint32_t N, uint64_t T) {
+    if (DemandTrace::is_trace(filename)) {
+        return std::make_unique<TraceDemandSource>(filename, N, T);
+    } else if (DeltaTrace::is_delta_trace(filename)) {
+        return std::make_unique<DeltaTraceDemandSource>(filename, N, T);
+    }
+    return std::make_unique<TextDemandSource>(filename, N, T);
+}
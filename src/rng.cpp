@@ -0,0 +1,63 @@
+#include "rng.h"
+
+#include <random>
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+Philox::Philox(uint64_t seed, uint64_t stream) {
+    this->seed(seed, stream);
+}
+
+void Philox::seed(uint64_t seed, uint64_t stream) {
+    key_ = {(uint32_t)seed, (uint32_t)(seed >> 32)};
+    stream_ = stream;
+    index_ = 0;
+    pos_ = 4;
+}
+
+Philox::result_type Philox::operator()() {
+    if (pos_ == 4) {
+        refill();
+    }
+    return out_[pos_++];
+}
+
+void Philox::discard(uint64_t n) {
+    uint64_t left = 4 - pos_;
+    if (n <= left) {
+        pos_ += n;
+        return;
+    }
+    n -= left;
+    index_ += n / 4;
+    refill();
+    pos_ = n % 4;
+}
+
+// Counter words are (block index, stream), low word first
+void Philox::refill() {
+    counter ctr = {(uint32_t)index_, (uint32_t)(index_ >> 32), (uint32_t)stream_, (uint32_t)(stream_ >> 32)};
+    out_ = block(ctr, key_);
+    index_++;
+    pos_ = 0;
+}
+
+Philox::counter Philox::block(counter ctr, key k) {
+    for (int r = 0; r < PHILOX_ROUNDS; ++r) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * ctr[0];
+        uint64_t p1 = (uint64_t)PHILOX_M1 * ctr[2];
+        ctr = {(uint32_t)(p1 >> 32) ^ ctr[1] ^ k[0], (uint32_t)p1, (uint32_t)(p0 >> 32) ^ ctr[3] ^ k[1], (uint32_t)p0};
+        k[0] += PHILOX_W0;
+        k[1] += PHILOX_W1;
+    }
+    return ctr;
+}
+
+uint64_t random_seed() {
+    std::random_device rd;
+    return ((uint64_t)rd() << 32) | rd();
+}
@@ -0,0 +1,315 @@
+#include "server.h"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ios>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+// Bytes read per recv() and the pending output past which a connection stops
+// reading until its client catches up
+#define READ_CHUNK (1 << 16)
+#define MAX_PENDING_OUTPUT (1 << 22)
+
+AllocServer::AllocServer(QuantumScheduler& sched, const std::string& socket_path, uint32_t num_threads)
+    : sched_(sched), path_(socket_path), num_threads_(num_threads) {
+    if (num_threads == 0) {
+        throw std::invalid_argument("server needs at least one I/O thread");
+    }
+    if (socket_path.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::invalid_argument("socket path is too long");
+    }
+}
+
+AllocServer::~AllocServer() {
+    stop();
+}
+
+void AllocServer::start() {
+    if (!threads_.empty()) {
+        return;
+    }
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path_.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path_.c_str());
+    if (listen_fd_ < 0 || bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd_, SOMAXCONN) < 0) {
+        stop();
+        throw std::ios_base::failure("failed to listen on server socket");
+    }
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd_ < 0) {
+        stop();
+        throw std::ios_base::failure("failed to create server stop event");
+    }
+
+    for (uint32_t t = 0; t < num_threads_; ++t) {
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd >= 0) {
+            epoll_fds_.push_back(epoll_fd);
+        }
+        epoll_event listen_ev = {}, stop_ev = {};
+        listen_ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        listen_ev.data.fd = listen_fd_;
+        stop_ev.events = EPOLLIN;
+        stop_ev.data.fd = stop_fd_;
+        if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd_, &listen_ev) < 0 ||
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd_, &stop_ev) < 0) {
+            stop();
+            throw std::ios_base::failure("failed to set up server epoll");
+        }
+    }
+    for (int epoll_fd : epoll_fds_) {
+        threads_.emplace_back(&AllocServer::serve, this, epoll_fd);
+    }
+}
+
+void AllocServer::stop() {
+    if (listen_fd_ < 0) {
+        return;
+    }
+    if (!threads_.empty()) {
+        wake_threads();
+    }
+    for (auto& t : threads_) {
+        t.join();
+    }
+    threads_.clear();
+
+    for (int fd : epoll_fds_) {
+        close(fd);
+    }
+    epoll_fds_.clear();
+    for (int fd : wake_fds_) {
+        close(fd);
+    }
+    wake_fds_.clear();
+    for (int* fd : {&listen_fd_, &stop_fd_}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    unlink(path_.c_str());
+}
+
+void AllocServer::wake_threads() {
+    uint64_t one = 1;
+    ssize_t n;
+    do {
+        n = write(stop_fd_, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+    if (n >= 0) {
+        return;
+    }
+
+    // stop() may run from the destructor, so it cannot throw. Instead add an
+    // already signalled eventfd to every epoll set, tagged as the stop event;
+    // inserting a ready fd wakes the waiting thread.
+    int wake_fd = eventfd(1, EFD_CLOEXEC);
+    epoll_event stop_ev = {};
+    stop_ev.events = EPOLLIN;
+    stop_ev.data.fd = stop_fd_;
+    for (int epoll_fd : epoll_fds_) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &stop_ev);
+    }
+    if (wake_fd >= 0) {
+        wake_fds_.push_back(wake_fd);
+    }
+}
+
+uint64_t AllocServer::get_num_updates() const {
+    return updates_.load(std::memory_order_relaxed);
+}
+
+void AllocServer::serve(int epoll_fd) {
+    std::unordered_map<int, std::unique_ptr<Connection>> conns;
+    epoll_event events[64];
+
+    while (true) {
+        int n = epoll_wait(epoll_fd, events, 64, -1);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == stop_fd_) {
+                for (auto& [conn_fd, c] : conns) {
+                    close(conn_fd);
+                }
+                return;
+            } else if (fd == listen_fd_) {
+                accept_all(epoll_fd);
+                continue;
+            }
+
+            auto it = conns.find(fd);
+            if (it == conns.end()) {
+                it = conns.emplace(fd, std::make_unique<Connection>()).first;
+                it->second->fd_ = fd;
+            }
+            Connection& c = *it->second;
+
+            bool open = !(events[i].events & (EPOLLERR | EPOLLHUP)) || (events[i].events & EPOLLIN);
+            if (open && (events[i].events & EPOLLOUT)) {
+                open = flush(epoll_fd, c);
+            }
+            if (open && (events[i].events & EPOLLIN)) {
+                open = on_readable(epoll_fd, c);
+            }
+            if (!open) {
+                close(fd);
+                conns.erase(it);
+            }
+        }
+    }
+}
+
+void AllocServer::accept_all(int epoll_fd) {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+bool AllocServer::on_readable(int epoll_fd, Connection& c) {
+    while (true) {
+        if (c.in_.size() - c.in_len_ < READ_CHUNK) {
+            c.in_.resize(c.in_len_ + READ_CHUNK);
+        }
+        ssize_t n = recv(c.fd_, c.in_.data() + c.in_len_, c.in_.size() - c.in_len_, 0);
+        if (n == 0) {
+            return false;
+        } else if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+        c.in_len_ += n;
+        if (!handle_messages(c)) {
+            return false;
+        }
+        if (c.out_.size() - c.out_pos_ > MAX_PENDING_OUTPUT) {
+            break;
+        }
+    }
+    return flush(epoll_fd, c);
+}
+
+// Writes pending replies; while any remain the connection waits for
+// EPOLLOUT instead of reading more requests
+bool AllocServer::flush(int epoll_fd, Connection& c) {
+    while (c.out_pos_ < c.out_.size()) {
+        ssize_t n = send(c.fd_, c.out_.data() + c.out_pos_, c.out_.size() - c.out_pos_, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+        c.out_pos_ += n;
+    }
+
+    bool blocked = c.out_pos_ < c.out_.size();
+    if (!blocked) {
+        c.out_.clear();
+        c.out_pos_ = 0;
+    }
+    if (blocked != c.blocked_) {
+        c.blocked_ = blocked;
+        epoll_event ev = {};
+        ev.events = blocked ? EPOLLOUT : EPOLLIN;
+        ev.data.fd = c.fd_;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd_, &ev);
+    }
+    return true;
+}
+
+bool AllocServer::handle_messages(Connection& c) {
+    size_t pos = 0;
+    while (c.in_len_ - pos >= sizeof(MsgHeader)) {
+        MsgHeader header;
+        memcpy(&header, c.in_.data() + pos, sizeof(header));
+        uint32_t size = record_size(header.type_);
+        if (size == 0 || header.count_ > MSG_MAX_RECORDS) {
+            return false;
+        }
+
+        size_t len = sizeof(header) + (size_t)header.count_ * size;
+        if (c.in_len_ - pos < len) {
+            break;
+        }
+        handle_message(header, c.in_.data() + pos + sizeof(header), c.out_);
+        pos += len;
+    }
+
+    // Keep a partial message at the front of the buffer for the next read
+    memmove(c.in_.data(), c.in_.data() + pos, c.in_len_ - pos);
+    c.in_len_ -= pos;
+    return true;
+}
+
+void AllocServer::handle_message(const MsgHeader& header, const uint8_t* records, std::vector<uint8_t>& out) {
+    MsgHeader reply;
+    reply.type_ = header.type_;
+    size_t at = out.size();
+
+    if (header.type_ == MSG_GET_ALLOCATIONS) {
+        reply.count_ = header.count_;
+        out.resize(at + sizeof(reply) + sizeof(uint64_t) + header.count_ * sizeof(uint32_t));
+
+        // Record offsets are multiples of 4 within a 4-aligned buffer
+        uint8_t* body = out.data() + at + sizeof(reply);
+        uint64_t quantum = sched_.get_allocations((const uint32_t*)records, header.count_,
+                                                  (uint32_t*)(body + sizeof(uint64_t)));
+        memcpy(body, &quantum, sizeof(quantum));
+        memcpy(out.data() + at, &reply, sizeof(reply));
+        return;
+    }
+
+    for (uint32_t k = 0; k < header.count_; ++k) {
+        try {
+            if (header.type_ == MSG_SET_DEMANDS) {
+                DemandUpdate u;
+                memcpy(&u, records + k * sizeof(u), sizeof(u));
+                sched_.set_demand(u.id_, u.demand_ & ~DEMAND_GREEDY, u.demand_ & DEMAND_GREEDY);
+            } else {
+                uint32_t id;
+                memcpy(&id, records + k * sizeof(id), sizeof(id));
+                if (header.type_ == MSG_ADD_TENANTS) {
+                    sched_.add_tenant(id);
+                } else {
+                    sched_.remove_tenant(id);
+                }
+            }
+        } catch (const std::logic_error&) {
+            reply.count_++;
+        }
+    }
+    if (header.type_ == MSG_SET_DEMANDS) {
+        updates_.fetch_add(header.count_ - reply.count_, std::memory_order_relaxed);
+    }
+
+    out.resize(at + sizeof(reply));
+    memcpy(out.data() + at, &reply, sizeof(reply));
+}
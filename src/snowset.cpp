@@ -0,0 +1,371 @@
+#include "snowset.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ios>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "allocator/thread_pool.h"
+
+typedef std::pair<const char*, const char*> span;
+
+static uint64_t fnv1a(span s) {
+    uint64_t h = 0xcbf29ce484222325;
+    for (const char* p = s.first; p < s.second; ++p) {
+        h = (h ^ (uint8_t)*p) * 0x100000001b3;
+    }
+    return h;
+}
+
+// splitmix64 finalizer, used to rank tenants for sampling
+static uint64_t mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+static bool is_null(span s) {
+    return s.first == s.second || (s.second - s.first == 2 && s.first[0] == '\\' && s.first[1] == 'N');
+}
+
+// Reads up to max_digits decimal digits, returning how many were read
+static int read_digits(const char*& p, const char* end, int64_t& value, int max_digits = 18) {
+    int n = 0;
+    value = 0;
+    for (; p < end && n < max_digits && *p >= '0' && *p <= '9'; ++p, ++n) {
+        value = 10 * value + (*p - '0');
+    }
+    return n;
+}
+
+// Reads an optional fraction of a unit as milliseconds
+static void read_fraction_ms(const char*& p, const char* end, int64_t& ms) {
+    ms = 0;
+    if (p == end || *p != '.') {
+        return;
+    }
+    int64_t scale = 100;
+    for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+        ms += (*p - '0') * scale;
+        scale /= 10;
+    }
+}
+
+static int64_t days_from_civil(int64_t y, int64_t m, int64_t d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Accepts "YYYY-MM-DD HH:MM:SS[.fff][Z|+HH[:MM]]" in UTC unless an offset is
+// given, or plain (fractional) Unix seconds as written by dataloader.ipynb
+static bool parse_time_ms(span s, int64_t& ms) {
+    const char *p = s.first, *end = s.second;
+    int64_t v[6], frac;
+    if (end - p < 10 || p[4] != '-') {
+        if (read_digits(p, end, v[0]) == 0) {
+            return false;
+        }
+        read_fraction_ms(p, end, frac);
+        ms = v[0] * 1000 + frac;
+        return p == end;
+    }
+
+    const char seps[] = "-- ::";
+    for (int k = 0; k < 6; ++k) {
+        if (read_digits(p, end, v[k], k == 0 ? 4 : 2) != (k == 0 ? 4 : 2)) {
+            return false;
+        }
+        if (k < 5) {
+            if (p == end || (*p != seps[k] && !(k == 2 && *p == 'T'))) {
+                return false;
+            }
+            p++;
+        }
+    }
+    read_fraction_ms(p, end, frac);
+    ms = (days_from_civil(v[0], v[1], v[2]) * 86400 + v[3] * 3600 + v[4] * 60 + v[5]) * 1000 + frac;
+
+    if (p < end && *p == 'Z') {
+        p++;
+    } else if (p < end && (*p == '+' || *p == '-')) {
+        int64_t sign = *p++ == '-' ? -1 : 1, hours, minutes = 0;
+        if (read_digits(p, end, hours, 2) != 2) {
+            return false;
+        }
+        if (p < end && *p == ':') {
+            p++;
+        }
+        read_digits(p, end, minutes, 2);
+        ms -= sign * (hours * 60 + minutes) * 60000;
+    }
+    return p == end;
+}
+
+static bool parse_duration_ms(span s, int64_t& ms) {
+    const char* p = s.first;
+    int64_t frac;
+    if (read_digits(p, s.second, ms) == 0) {
+        return false;
+    }
+    read_fraction_ms(p, s.second, frac);
+    return p == s.second;
+}
+
+// Splits off the field at p, unquoting it, and leaves p on the delimiter
+static span next_field(const char*& p, const char* end) {
+    span field;
+    if (p < end && *p == '"') {
+        field.first = ++p;
+        while (p < end && (*p != '"' || (p + 1 < end && p[1] == '"'))) {
+            p += *p == '"' ? 2 : 1;
+        }
+        field.second = p;
+        p = std::min(p + 1, end);
+    } else {
+        field.first = p;
+        while (p < end && *p != ',' && *p != '\n') {
+            p++;
+        }
+        field.second = p;
+    }
+    if (field.second > field.first && field.second[-1] == '\r') {
+        field.second--;
+    }
+    return field;
+}
+
+SnowsetLoader::SnowsetLoader(const std::string& filename, const std::string& tenant_column) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::ios_base::failure("failed to open Snowset file");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        throw std::ios_base::failure("Snowset file is empty");
+    }
+    map_size_ = st.st_size;
+    map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        throw std::ios_base::failure("failed to map Snowset file");
+    }
+    end_ = (const char*)map_ + map_size_;
+
+    const char* p = (const char*)map_;
+    const char* nl = (const char*)std::memchr(p, '\n', end_ - p);
+    body_ = nl != nullptr ? nl + 1 : end_;
+
+    std::unordered_map<std::string, uint32_t> columns;
+    for (uint32_t col = 0; p < body_; ++col) {
+        span name = next_field(p, body_);
+        columns.emplace(std::string(name.first, name.second), col);
+        if (p == body_ || *p == '\n') {
+            break;
+        }
+        p++;
+    }
+
+    uint32_t* targets[] = {&tenant_col_, &created_col_, &duration_col_};
+    std::string names[] = {tenant_column, "createdTime", "durationTotal"};
+    for (int k = 0; k < 3; ++k) {
+        auto it = columns.find(names[k]);
+        if (it == columns.end()) {
+            munmap(map_, map_size_);
+            map_ = nullptr;
+            throw std::invalid_argument("SnowsetLoader(): CSV has no " + names[k] + " column");
+        }
+        *targets[k] = it->second;
+    }
+    last_col_ = std::max({tenant_col_, created_col_, duration_col_});
+}
+
+SnowsetLoader::~SnowsetLoader() {
+    if (map_ != nullptr) {
+        munmap(map_, map_size_);
+    }
+}
+
+std::vector<span> SnowsetLoader::split(size_t n) {
+    std::vector<span> chunks;
+    const char* begin = body_;
+    for (size_t k = 1; k <= n && begin < end_; ++k) {
+        const char* stop = k == n ? end_ : std::max(begin, body_ + (end_ - body_) * k / n);
+        if (stop < end_) {
+            const char* nl = (const char*)std::memchr(stop, '\n', end_ - stop);
+            stop = nl != nullptr ? nl + 1 : end_;
+        }
+        chunks.emplace_back(begin, stop);
+        begin = stop;
+    }
+    return chunks;
+}
+
+const char* SnowsetLoader::parse_row(const char* p, const char* end, Query& q, bool& valid) {
+    span tenant, created, duration;
+    bool complete = false;
+    for (uint32_t col = 0; p < end; ++col) {
+        span field = next_field(p, end);
+        if (col == tenant_col_) {
+            tenant = field;
+        }
+        if (col == created_col_) {
+            created = field;
+        }
+        if (col == duration_col_) {
+            duration = field;
+        }
+        if (col == last_col_) {
+            complete = true;
+            break;
+        }
+        if (p == end || *p == '\n') {
+            break;
+        }
+        p++;
+    }
+
+    const char* nl = p < end ? (const char*)std::memchr(p, '\n', end - p) : nullptr;
+    valid = complete && !is_null(tenant) && parse_time_ms(created, q.created_ms_) &&
+            parse_duration_ms(duration, q.duration_ms_);
+    if (valid) {
+        q.tenant_ = fnv1a(tenant);
+    }
+    return nl != nullptr ? nl + 1 : end;
+}
+
+uint64_t SnowsetLoader::get_num_quanta(uint64_t start, uint64_t end, uint32_t quantum) {
+    if (end <= start || quantum == 0) {
+        throw std::invalid_argument("bin(): window and quantum must be non-empty");
+    }
+    return (end - start + quantum - 1) / quantum;
+}
+
+matrix SnowsetLoader::bin(uint64_t start, uint64_t end, uint32_t quantum, uint32_t N, uint64_t seed,
+                          uint32_t num_threads) {
+    matrix demands;
+    bin(start, end, quantum, N, seed, num_threads, [&](const std::vector<uint32_t>& row) {
+        demands.push_back(row);
+    });
+    return demands;
+}
+
+void SnowsetLoader::bin(uint64_t start, uint64_t end, uint32_t quantum, uint32_t N, uint64_t seed,
+                        uint32_t num_threads, const std::function<void(const std::vector<uint32_t>&)>& emit) {
+    uint64_t T = get_num_quanta(start, end, quantum);
+    int64_t start_ms = start * 1000, end_ms = end * 1000, quantum_ms = (int64_t)quantum * 1000;
+
+    ThreadPool pool(std::max(num_threads, 1u));
+    auto chunks = split(4 * pool.get_num_threads());
+
+    // First pass collects the tenants active in the window
+    std::vector<std::unordered_set<uint64_t>> active(chunks.size());
+    std::vector<uint64_t> skipped(chunks.size(), 0);
+    pool.run(chunks.size(), [&](size_t c) {
+        Query q;
+        bool valid;
+        for (const char* p = chunks[c].first; p < chunks[c].second;) {
+            p = parse_row(p, chunks[c].second, q, valid);
+            if (!valid) {
+                skipped[c]++;
+            } else if (q.created_ms_ >= start_ms && q.created_ms_ < end_ms) {
+                active[c].insert(q.tenant_);
+            }
+        }
+    });
+
+    // Sampling the N lowest seeded hashes picks a uniform subset without a
+    // global view of the rows; columns follow the same order
+    std::unordered_set<uint64_t> merged;
+    std::vector<std::pair<uint64_t, uint64_t>> ranked;
+    for (auto& tenants : active) {
+        for (uint64_t tenant : tenants) {
+            if (merged.insert(tenant).second) {
+                ranked.emplace_back(mix(tenant ^ seed), tenant);
+            }
+        }
+    }
+    std::sort(ranked.begin(), ranked.end());
+    ranked.resize(std::min<size_t>(ranked.size(), N));
+
+    std::unordered_map<uint64_t, uint32_t> columns;
+    for (uint32_t k = 0; k < ranked.size(); ++k) {
+        columns[ranked[k].second] = k;
+    }
+
+    // Second pass records each sampled query as the quanta [s, e) it runs in,
+    // kept as a +1 edge at s and a -1 edge at e and sorted by quantum. A query
+    // occupies at least the quantum it was created in.
+    struct Edge {
+        uint64_t t_;
+        uint32_t col_;
+        int32_t delta_;
+
+        bool operator<(const Edge& other) const {
+            return t_ < other.t_;
+        }
+    };
+    std::vector<std::vector<Edge>> edges(chunks.size());
+    std::vector<uint64_t> queries(chunks.size(), 0);
+    pool.run(chunks.size(), [&](size_t c) {
+        Query q;
+        bool valid;
+        for (const char* p = chunks[c].first; p < chunks[c].second;) {
+            p = parse_row(p, chunks[c].second, q, valid);
+            if (!valid || q.created_ms_ < start_ms || q.created_ms_ >= end_ms) {
+                continue;
+            }
+            auto it = columns.find(q.tenant_);
+            if (it != columns.end()) {
+                int64_t offset = q.created_ms_ - start_ms;
+                uint64_t s = offset / quantum_ms;
+                uint64_t e = (offset + std::max<int64_t>(q.duration_ms_, 1) - 1) / quantum_ms + 1;
+                edges[c].push_back({s, it->second, 1});
+                if (e < T) {
+                    edges[c].push_back({e, it->second, -1});
+                }
+                queries[c]++;
+            }
+        }
+        std::sort(edges[c].begin(), edges[c].end());
+    });
+
+    num_queries_ = num_skipped_ = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        num_queries_ += queries[c];
+        num_skipped_ += skipped[c];
+    }
+
+    // Sweep the quanta in order, applying every chunk's edges to one running
+    // row. Within a quantum, unsigned wraparound cancels out.
+    std::vector<uint32_t> row(ranked.size(), 0);
+    std::vector<size_t> next(chunks.size(), 0);
+    for (uint64_t t = 0; t < T; ++t) {
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            for (; next[c] < edges[c].size() && edges[c][next[c]].t_ == t; ++next[c]) {
+                row[edges[c][next[c]].col_] += edges[c][next[c]].delta_;
+            }
+        }
+        emit(row);
+    }
+}
+
+uint64_t SnowsetLoader::get_num_queries() {
+    return num_queries_;
+}
+
+uint64_t SnowsetLoader::get_num_skipped() {
+    return num_skipped_;
+}
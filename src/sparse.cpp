@@ -0,0 +1,38 @@
+#include "sparse.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+void SparseRow::clear() {
+    pos_.clear();
+    val_.clear();
+}
+
+size_t SparseRow::size() const {
+    return pos_.size();
+}
+
+void SparseRow::push_back(uint32_t pos, uint32_t val) {
+    assert(pos_.empty() || pos_.back() < pos);
+    pos_.push_back(pos);
+    val_.push_back(val);
+}
+
+void SparseRow::assign(const std::vector<uint32_t>& dense) {
+    clear();
+    for (uint32_t k = 0; k < dense.size(); ++k) {
+        if (dense[k] != 0) {
+            pos_.push_back(k);
+            val_.push_back(dense[k]);
+        }
+    }
+}
+
+void SparseRow::to_dense(uint32_t N, std::vector<uint32_t>& dense) const {
+    dense.assign(N, 0);
+    for (size_t k = 0; k < pos_.size(); ++k) {
+        assert(pos_[k] < N);
+        dense[pos_[k]] = val_[k];
+    }
+}
@@ -0,0 +1,441 @@
+#include "trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+static uint32_t fit_width(uint32_t max_demand) {
+    if (max_demand <= UINT8_MAX) {
+        return 1;
+    } else if (max_demand <= UINT16_MAX) {
+        return 2;
+    }
+    return 4;
+}
+
+static void write_demand(std::ostream& out, uint32_t demand, uint32_t width) {
+    uint8_t bytes[4];
+    for (uint32_t b = 0; b < width; ++b) {
+        bytes[b] = (demand >> (8 * b)) & 0xff;
+    }
+    out.write((const char*)bytes, width);
+}
+
+// Maps a trace file and checks its magic, returning the header
+static const uint8_t* map_trace(const std::string& filename, uint32_t magic, TraceHeader& header, void*& map,
+                                size_t& map_size) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::ios_base::failure("failed to open trace file");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        close(fd);
+        throw std::ios_base::failure("trace file is missing its header");
+    }
+    map_size = st.st_size;
+    map = mmap(nullptr, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        map = nullptr;
+        throw std::ios_base::failure("failed to map trace file");
+    }
+
+    std::memcpy(&header, map, sizeof(TraceHeader));
+    if (header.magic_ != magic) {
+        munmap(map, map_size);
+        map = nullptr;
+        throw std::ios_base::failure("malformed trace file");
+    }
+    madvise(map, map_size, MADV_SEQUENTIAL);
+    return (const uint8_t*)map + sizeof(TraceHeader);
+}
+
+static bool has_magic(const std::string& filename, uint32_t expected) {
+    std::ifstream file(filename, std::ios::binary);
+    uint32_t magic = 0;
+    file.read((char*)&magic, sizeof(magic));
+    return file && magic == expected;
+}
+
+static void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(v);
+}
+
+static uint32_t zigzag(uint32_t delta) {
+    return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+}
+
+static uint32_t unzigzag(uint32_t v) {
+    return (v >> 1) ^ (0 - (v & 1));
+}
+
+TraceRow::TraceRow(const uint8_t* data, uint32_t width, uint32_t N) : data_(data), width_(width), N_(N) {
+}
+
+uint32_t TraceRow::operator[](uint32_t i) const {
+    const uint8_t* p = data_ + (size_t)i * width_;
+    switch (width_) {
+        case 1:
+            return p[0];
+        case 2:
+            return p[0] | (p[1] << 8);
+        default:
+            return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+}
+
+uint32_t TraceRow::size() const {
+    return N_;
+}
+
+void TraceRow::copy_to(std::vector<uint32_t>& demands) const {
+    demands.resize(N_);
+    if (width_ == 4) {
+        std::memcpy(demands.data(), data_, (size_t)N_ * 4);
+    } else if (width_ == 2) {
+        for (uint32_t i = 0; i < N_; ++i) {
+            demands[i] = data_[2 * i] | (data_[2 * i + 1] << 8);
+        }
+    } else {
+        std::copy(data_, data_ + N_, demands.begin());
+    }
+}
+
+DemandTrace::DemandTrace(const std::string& filename) {
+    rows_ = map_trace(filename, TRACE_MAGIC, header_, map_, map_size_);
+    size_t expected = sizeof(TraceHeader) + header_.T_ * header_.N_ * header_.width_;
+    if (header_.version_ != TRACE_VERSION || (header_.width_ != 1 && header_.width_ != 2 && header_.width_ != 4) ||
+        map_size_ < expected) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        throw std::ios_base::failure("malformed trace file");
+    }
+}
+
+DemandTrace::~DemandTrace() {
+    if (map_ != nullptr) {
+        munmap(map_, map_size_);
+    }
+}
+
+bool DemandTrace::is_trace(const std::string& filename) {
+    return has_magic(filename, TRACE_MAGIC);
+}
+
+uint32_t DemandTrace::get_num_tenants() const {
+    return header_.N_;
+}
+
+uint64_t DemandTrace::get_num_quanta() const {
+    return header_.T_;
+}
+
+uint32_t DemandTrace::get_width() const {
+    return header_.width_;
+}
+
+TraceRow DemandTrace::row(uint64_t t) const {
+    if (t >= header_.T_) {
+        throw std::out_of_range("row(): quantum is past the end of the trace");
+    }
+    return TraceRow(rows_ + t * header_.N_ * header_.width_, header_.width_, header_.N_);
+}
+
+DeltaTrace::DeltaTrace(const std::string& filename) {
+    const uint8_t* data = map_trace(filename, DELTA_TRACE_MAGIC, header_, map_, map_size_);
+    size_t available = map_size_ - sizeof(TraceHeader);
+    uint64_t num_blocks = header_.block_rows_ > 0 ? (header_.T_ + header_.block_rows_ - 1) / header_.block_rows_ : 0;
+    if (header_.version_ != TRACE_VERSION || header_.width_ != 0 || header_.block_rows_ == 0 ||
+        available < (num_blocks + 1) * sizeof(uint64_t)) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        throw std::ios_base::failure("malformed trace file");
+    }
+    index_ = (const uint64_t*)data;
+    rows_ = data + (num_blocks + 1) * sizeof(uint64_t);
+    rows_size_ = available - (num_blocks + 1) * sizeof(uint64_t);
+
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        if (index_[b] > index_[b + 1]) {
+            munmap(map_, map_size_);
+            map_ = nullptr;
+            throw std::ios_base::failure("malformed trace file");
+        }
+    }
+    if (index_[num_blocks] > rows_size_) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        throw std::ios_base::failure("malformed trace file");
+    }
+}
+
+DeltaTrace::~DeltaTrace() {
+    if (map_ != nullptr) {
+        munmap(map_, map_size_);
+    }
+}
+
+bool DeltaTrace::is_delta_trace(const std::string& filename) {
+    return has_magic(filename, DELTA_TRACE_MAGIC);
+}
+
+uint32_t DeltaTrace::get_num_tenants() const {
+    return header_.N_;
+}
+
+uint64_t DeltaTrace::get_num_quanta() const {
+    return header_.T_;
+}
+
+uint64_t DeltaTrace::get_block_rows() const {
+    return header_.block_rows_;
+}
+
+std::pair<const uint8_t*, const uint8_t*> DeltaTrace::block(uint64_t t) const {
+    if (t >= header_.T_) {
+        throw std::out_of_range("block(): quantum is past the end of the trace");
+    }
+    uint64_t b = t / header_.block_rows_;
+    return {rows_ + index_[b], rows_ + index_[b + 1]};
+}
+
+DeltaTraceReader::DeltaTraceReader(const DeltaTrace& trace) : trace_(trace), row_(trace.get_num_tenants(), 0) {
+    seek(0);
+}
+
+void DeltaTraceReader::seek(uint64_t t) {
+    t_ = std::min(t, trace_.get_num_quanta());
+    if (t_ == trace_.get_num_quanta()) {
+        return;
+    }
+
+    uint64_t first = t_ - t_ % trace_.get_block_rows();
+    std::tie(p_, end_) = trace_.block(first);
+    decode_row(false);
+    for (uint64_t s = first + 1; s <= t_; ++s) {
+        decode_row(true);
+    }
+}
+
+bool DeltaTraceReader::next(std::vector<uint32_t>& demands) {
+    if (t_ == trace_.get_num_quanta()) {
+        return false;
+    }
+    demands = row_;
+
+    if (++t_ < trace_.get_num_quanta()) {
+        if (t_ % trace_.get_block_rows() == 0) {
+            std::tie(p_, end_) = trace_.block(t_);
+            decode_row(false);
+        } else {
+            decode_row(true);
+        }
+    }
+    return true;
+}
+
+// Rows well inside the block skip the per-byte bounds check, since a row has
+// at most N tokens of at most 5 bytes
+void DeltaTraceReader::decode_row(bool delta) {
+    uint32_t N = row_.size();
+    uint32_t* row = row_.data();
+    const uint8_t* p = p_;
+    bool checked = (size_t)(end_ - p) < 5 * (size_t)N;
+
+    if (!delta) {
+        std::fill(row_.begin(), row_.end(), 0);
+    }
+    for (uint32_t i = 0; i < N;) {
+        uint64_t v;
+        if (!checked && *p < 0x80) {
+            v = *p++;
+        } else {
+            v = 0;
+            for (uint32_t shift = 0;; shift += 7) {
+                if (p == end_ || shift > 28) {
+                    throw std::ios_base::failure("malformed trace file");
+                }
+                uint8_t b = *p++;
+                v |= (uint64_t)(b & 0x7f) << shift;
+                if (b < 0x80) {
+                    break;
+                }
+            }
+        }
+
+        if (v & 1) {
+            i += (v >> 1) + 1;
+            if (i > N) {
+                throw std::ios_base::failure("malformed trace file");
+            }
+        } else {
+            row[i++] += unzigzag(v >> 1);
+        }
+    }
+    p_ = p;
+}
+
+void write_trace(const std::string& filename, matrix& demands) {
+    TraceHeader header;
+    header.T_ = demands.size();
+    header.N_ = demands.empty() ? 0 : demands[0].size();
+
+    uint32_t max_demand = 0;
+    for (auto& row : demands) {
+        if (row.size() != header.N_) {
+            throw std::invalid_argument("write_trace(): rows must have the same number of tenants");
+        }
+        max_demand = std::max(max_demand, *std::max_element(row.begin(), row.end()));
+    }
+    header.width_ = fit_width(max_demand);
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        throw std::ios_base::failure("failed to open trace file");
+    }
+    out.write((const char*)&header, sizeof(header));
+    for (auto& row : demands) {
+        for (uint32_t d : row) {
+            write_demand(out, d, header.width_);
+        }
+    }
+}
+
+DeltaTraceWriter::DeltaTraceWriter(const std::string& filename, uint32_t N, uint64_t T, uint64_t block_rows)
+    : out_(filename, std::ios::binary), prev_(N, 0) {
+    if (block_rows == 0) {
+        throw std::invalid_argument("DeltaTraceWriter(): blocks must hold at least one quantum");
+    }
+    if (!out_) {
+        throw std::ios_base::failure("failed to open trace file");
+    }
+    header_.magic_ = DELTA_TRACE_MAGIC;
+    header_.width_ = 0;
+    header_.N_ = N;
+    header_.T_ = T;
+    header_.block_rows_ = block_rows;
+
+    // Room for the index, filled in by close()
+    index_.assign((T + block_rows - 1) / block_rows + 1, 0);
+    out_.write((const char*)&header_, sizeof(header_));
+    out_.write((const char*)index_.data(), index_.size() * sizeof(uint64_t));
+    index_.clear();
+}
+
+void DeltaTraceWriter::append(const std::vector<uint32_t>& demands) {
+    if (t_ == header_.T_) {
+        throw std::out_of_range("append(): trace already holds T quanta");
+    }
+    if (demands.size() != header_.N_) {
+        throw std::invalid_argument("append(): expected one demand per tenant");
+    }
+
+    // A block's first row is stored against zero so it decodes on its own
+    if (t_ % header_.block_rows_ == 0) {
+        flush();
+        index_.push_back(offset_);
+        std::fill(prev_.begin(), prev_.end(), 0);
+    }
+    for (uint32_t i = 0; i < header_.N_;) {
+        uint32_t change = demands[i] - prev_[i];
+        if (change != 0) {
+            put_varint(block_, (uint64_t)zigzag(change) << 1);
+            i++;
+            continue;
+        }
+        uint32_t run = 1;
+        while (i + run < header_.N_ && demands[i + run] == prev_[i + run]) {
+            run++;
+        }
+        put_varint(block_, (uint64_t)(run - 1) << 1 | 1);
+        i += run;
+    }
+    prev_ = demands;
+    t_++;
+}
+
+void DeltaTraceWriter::flush() {
+    out_.write((const char*)block_.data(), block_.size());
+    offset_ += block_.size();
+    block_.clear();
+}
+
+void DeltaTraceWriter::close() {
+    if (t_ != header_.T_) {
+        throw std::invalid_argument("close(): trace holds fewer than T quanta");
+    }
+    flush();
+    index_.push_back(offset_);
+    out_.seekp(sizeof(header_));
+    out_.write((const char*)index_.data(), index_.size() * sizeof(uint64_t));
+    out_.close();
+    if (!out_) {
+        throw std::ios_base::failure("failed to write trace file");
+    }
+}
+
+void write_delta_trace(const std::string& filename, matrix& demands, uint64_t block_rows) {
+    DeltaTraceWriter writer(filename, demands.empty() ? 0 : demands[0].size(), demands.size(), block_rows);
+    for (auto& row : demands) {
+        writer.append(row);
+    }
+    writer.close();
+}
+
+void convert_text_trace(const std::string& text_filename, const std::string& trace_filename) {
+    // First pass sizes the trace and picks the width, second pass writes it
+    TraceHeader header;
+    uint32_t max_demand = 0;
+    {
+        std::ifstream text(text_filename);
+        if (!text) {
+            throw std::ios_base::failure("failed to open demands file");
+        }
+
+        std::string line;
+        while (std::getline(text, line)) {
+            std::istringstream tokens(line);
+            uint32_t n = 0, d;
+            while (tokens >> d) {
+                max_demand = std::max(max_demand, d);
+                n++;
+            }
+            if (n == 0) {
+                continue;
+            } else if (header.T_ == 0) {
+                header.N_ = n;
+            } else if (n != header.N_) {
+                throw std::invalid_argument("convert_text_trace(): rows must have the same number of tenants");
+            }
+            header.T_++;
+        }
+    }
+    header.width_ = fit_width(max_demand);
+
+    std::ifstream text(text_filename);
+    std::ofstream out(trace_filename, std::ios::binary);
+    if (!out) {
+        throw std::ios_base::failure("failed to open trace file");
+    }
+    out.write((const char*)&header, sizeof(header));
+
+    uint32_t d;
+    for (uint64_t k = 0; k < header.T_ * header.N_ && text >> d; ++k) {
+        write_demand(out, d, header.width_);
+    }
+}
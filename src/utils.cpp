@@ -3,45 +3,183 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <numeric>
 
-std::random_device rd;
-std::mt19937 gen(rd());
+#include "demand_source.h"
+#include "trace.h"
 
-bool rand_bool() {
-    static auto dist = std::uniform_int_distribution(0, 1);
-    return dist(gen);
+bool rand_bool(Philox& rng) {
+    auto dist = std::uniform_int_distribution(0, 1);
+    return dist(rng);
 }
 
-int rand_uniform(int min, int max) {
+int rand_uniform(Philox& rng, int min, int max) {
     auto dist = std::uniform_int_distribution(min, max);
-    return dist(gen);
+    return dist(rng);
 }
 
 std::discrete_distribution<> get_rand_discrete(std::vector<uint32_t>& weights) {
     return std::discrete_distribution<>(weights.begin(), weights.end());
 }
 
-int sample_rand_discrete(std::discrete_distribution<>& dist) {
-    return dist(gen);
+int sample_rand_discrete(Philox& rng, std::discrete_distribution<>& dist) {
+    return dist(rng);
 }
 
-matrix generate_uniform_demands(uint32_t N, uint32_t T, uint32_t max_demand) {
+// Uniform double in [0, 1) with 53 random bits
+static double rand_unit(Philox& rng) {
+    uint64_t hi = rng() >> 5, lo = rng() >> 6;
+    return (hi * 67108864.0 + lo) / 9007199254740992.0;
+}
+
+// log(k!) minus its Stirling approximation
+static double stirling_correction(uint64_t k) {
+    static const double table[] = {0.08106146679532726, 0.04134069595540929, 0.02767792568499834,
+                                   0.02079067210376509, 0.01664469118982119, 0.01387612882307075,
+                                   0.01189670994589177, 0.01041126526197209, 0.00925546218271273,
+                                   0.00833056343336287};
+    if (k < 10) {
+        return table[k];
+    }
+    double k1 = k + 1.0, k2 = k1 * k1;
+    return (1.0 / 12 - (1.0 / 360 - 1.0 / 1260 / k2) / k2) / k1;
+}
+
+// Walks the CDF from 0; the expected number of steps is about n * p
+static uint64_t binomial_inversion(Philox& rng, uint64_t n, double p) {
+    double q = 1 - p, s = p / q, a = (n + 1) * s, r0 = std::pow(q, (double)n);
+    while (true) {
+        double r = r0, u = rand_unit(rng);
+        uint64_t k = 0;
+        while (u > r && k <= n) {
+            u -= r;
+            k++;
+            r *= a / k - s;
+        }
+        if (k <= n) {
+            return k;
+        }
+    }
+}
+
+// Hormann's BTRD transformed rejection, for n * p >= 10 and p <= 0.5. It needs
+// no lgamma(), which writes the global signgam and so races between pools.
+static uint64_t binomial_btrd(Philox& rng, uint64_t n, double p) {
+    double q = 1 - p, npq = n * p * q, spq = std::sqrt(npq);
+    double m = std::floor((n + 1) * p), r = p / q, nr = (n + 1) * r;
+    double b = 1.15 + 2.53 * spq, a = -0.0873 + 0.0248 * b + 0.01 * p, c = n * p + 0.5;
+    double alpha = (2.83 + 5.1 / b) * spq, v_r = 0.92 - 4.2 / b, u_rv_r = 0.86 * v_r;
+
+    while (true) {
+        double u, v = rand_unit(rng);
+        if (v <= u_rv_r) {
+            u = v / v_r - 0.43;
+            return std::floor((2 * a / (0.5 - std::abs(u)) + b) * u + c);
+        }
+        if (v >= v_r) {
+            u = rand_unit(rng) - 0.5;
+        } else {
+            u = v / v_r - 0.93;
+            u = std::copysign(0.5, u) - u;
+            v = rand_unit(rng) * v_r;
+        }
+
+        double us = 0.5 - std::abs(u), k = std::floor((2 * a / us + b) * u + c);
+        if (k < 0 || k > n) {
+            continue;
+        }
+        v = v * alpha / (a / (us * us) + b);
+        double km = std::abs(k - m);
+
+        if (km <= 15) {
+            // Ratio f(k) / f(m) by recursion
+            double f = 1;
+            for (double i = m + 1; i <= k; ++i) {
+                f *= nr / i - r;
+            }
+            for (double i = k + 1; i <= m; ++i) {
+                v *= nr / i - r;
+            }
+            if (v <= f) {
+                return k;
+            }
+            continue;
+        }
+
+        // Squeeze, then the exact log-density test
+        v = std::log(v);
+        double rho = (km / npq) * (((km / 3 + 0.625) * km + 1.0 / 6) / npq + 0.5);
+        double t = -km * km / (2 * npq);
+        if (v < t - rho) {
+            return k;
+        } else if (v > t + rho) {
+            continue;
+        }
+
+        double nm = n - m + 1, nk = n - k + 1;
+        double h = (m + 0.5) * std::log((m + 1) / (r * nm)) + stirling_correction(m) + stirling_correction(n - m);
+        if (v <= h + (n + 1) * std::log(nm / nk) + (k + 0.5) * std::log(nk * r / (k + 1)) -
+                     stirling_correction(k) - stirling_correction(n - k)) {
+            return k;
+        }
+    }
+}
+
+uint64_t sample_rand_binomial(Philox& rng, uint64_t n, double p) {
+    if (p <= 0) {
+        return 0;
+    } else if (p >= 1) {
+        return n;
+    } else if (p > 0.5) {
+        return n - sample_rand_binomial(rng, n, 1 - p);
+    }
+    return n * p < 10 ? binomial_inversion(rng, n, p) : binomial_btrd(rng, n, p);
+}
+
+matrix generate_uniform_demands(uint32_t N, uint32_t T, uint32_t max_demand, uint64_t seed) {
     matrix demands(T, std::vector<uint32_t>(N));
+    Philox rng(seed);
 
     for (uint32_t t = 0; t < T; ++t) {
         for (uint32_t i = 0; i < N; ++i) {
-            demands[t][i] = rand_uniform(0, (int)max_demand);
+            demands[t][i] = rand_uniform(rng, 0, (int)max_demand);
         }
     }
     return demands;
 }
 
-matrix read_demands(char* filename, uint32_t N, uint32_t T, bool shuffle) {
+matrix read_demands(char* filename, uint32_t N, uint32_t T, bool shuffle, uint64_t seed) {
     matrix demands(T, std::vector<uint32_t>(N));
 
+    if (DemandTrace::is_trace(filename)) {
+        DemandTrace trace(filename);
+        if (trace.get_num_tenants() < N || trace.get_num_quanta() < T) {
+            throw std::invalid_argument("read_demands(): trace is smaller than N x T");
+        }
+        for (uint32_t t = 0; t < T; ++t) {
+            auto row = trace.row(t);
+            for (uint32_t i = 0; i < N; ++i) {
+                demands[t][i] = row[i];
+            }
+        }
+        if (shuffle) {
+            std::shuffle(demands.begin(), demands.end(), Philox(seed));
+        }
+        return demands;
+    } else if (DeltaTrace::is_delta_trace(filename)) {
+        DeltaTraceDemandSource source(filename, N, T);
+        for (uint32_t t = 0; t < T; ++t) {
+            source.next(demands[t]);
+        }
+        if (shuffle) {
+            std::shuffle(demands.begin(), demands.end(), Philox(seed));
+        }
+        return demands;
+    }
+
     std::ifstream file(filename);
     if (!file) {
         throw std::ios_base::failure("failed to open demands file");
@@ -55,45 +193,26 @@ matrix read_demands(char* filename, uint32_t N, uint32_t T, bool shuffle) {
     file.close();
 
     if (shuffle) {
-        std::shuffle(demands.begin(), demands.end(), gen);
+        std::shuffle(demands.begin(), demands.end(), Philox(seed));
     }
     return demands;
 }
 
 std::vector<double> welfares(matrix& demands, matrix& allocations) {
-    uint32_t N = demands[0].size();
-    std::vector<double> welfares(N);
-
-    for (uint32_t i = 0; i < N; ++i) {
-        uint64_t used = 0, total_demand = 0;
-        for (uint32_t t = 0; t < demands.size(); ++t) {
-            if (demands[t][i] > 0) {
-                used += std::min(demands[t][i], allocations[t][i]);
-                total_demand += demands[t][i];
-            }
-        }
-        welfares[i] = total_demand > 0 ? (double)used / total_demand : 1;
+    MetricAccumulator metrics(demands[0].size(), demands[0].size());
+    for (uint32_t t = 0; t < demands.size(); ++t) {
+        metrics.add_quantum(demands[t], allocations[t]);
     }
-    return welfares;
+    return metrics.get_welfares();
 }
 
 std::vector<double> welfares(matrix& demands, matrix& allocations,
                              matrix& payments, fi valuation) {
-    uint32_t N = demands[0].size();
-    std::vector<double> welfares(N);
-
-    for (uint32_t i = 0; i < N; ++i) {
-        double actual = 0, expected = 0;
-        for (uint32_t t = 0; t < demands.size(); ++t) {
-            if (demands[t][i] > 0) {
-                double w = (double)std::min(demands[t][t], allocations[t][i]) * valuation(demands[t][i]) / payments[t][i];
-                actual += std::min((double)demands[t][i], w);
-                expected += demands[t][i];
-            }
-        }
-        welfares[i] = expected > 0 ? actual / expected : 1;
+    MetricAccumulator metrics(demands[0].size(), demands[0].size());
+    for (uint32_t t = 0; t < demands.size(); ++t) {
+        metrics.add_quantum(demands[t], allocations[t], payments[t], valuation);
     }
-    return welfares;
+    return metrics.get_valued_welfares();
 }
 
 double fairness(std::vector<double>& welfares, size_t si) {
@@ -132,16 +251,114 @@ double instant_fairness(std::vector<uint32_t>& demands, std::vector<uint32_t>& a
 }
 
 double utilization(matrix& demands, matrix& allocations, uint64_t blocks) {
-    assert(blocks > 0);
-    uint32_t T = demands.size();
+    MetricAccumulator metrics(demands[0].size(), demands[0].size());
+    for (uint32_t t = 0; t < demands.size(); ++t) {
+        metrics.add_quantum(demands[t], allocations[t]);
+    }
+    return metrics.get_utilization(blocks);
+}
 
-    uint64_t used = 0;
-    for (uint32_t t = 0; t < T; ++t) {
-        for (uint32_t i = 0; i < demands[t].size(); ++i) {
-            used += std::min(demands[t][i], allocations[t][i]);
+MetricAccumulator::MetricAccumulator(uint32_t N, size_t si) : N_(N), si_(si) {
+    assert(si <= N);
+    reset();
+}
+
+void MetricAccumulator::reset() {
+    T_ = 0, total_used_ = 0;
+    total_fairness_ = 0;
+    used_.assign(N_, 0);
+    demanded_.assign(N_, 0);
+    valued_.assign(N_, 0);
+    expected_.assign(N_, 0);
+}
+
+void MetricAccumulator::add_quantum(std::vector<uint32_t>& demands, std::vector<uint32_t>& allocations) {
+    assert(demands.size() == N_ && allocations.size() == N_);
+    for (uint32_t i = 0; i < N_; ++i) {
+        uint32_t used = std::min(demands[i], allocations[i]);
+        total_used_ += used;
+        if (demands[i] > 0) {
+            used_[i] += used;
+            demanded_[i] += demands[i];
+        }
+    }
+    total_fairness_ += instant_fairness(demands, allocations, si_);
+    T_++;
+}
+
+// Matches the dense add_quantum(): idle tenants add nothing but count toward
+// instant fairness with a welfare of 1
+void MetricAccumulator::add_quantum(const SparseRow& demands, const SparseRow& allocations) {
+    assert(demands.size() == allocations.size());
+    uint32_t idle = N_ - si_;
+    double min_welfare = 1, max_welfare = 0;
+    for (size_t k = 0; k < demands.size(); ++k) {
+        uint32_t i = demands.pos_[k], demand = demands.val_[k];
+        assert(allocations.pos_[k] == i && i < N_);
+        uint32_t used = std::min(demand, allocations.val_[k]);
+        total_used_ += used;
+        if (demand == 0) {
+            continue;
+        }
+        used_[i] += used;
+        demanded_[i] += demand;
+
+        if (i >= si_) {
+            double welfare = (double)used / demand;
+            min_welfare = std::min(min_welfare, welfare);
+            max_welfare = std::max(max_welfare, welfare);
+            idle--;
+        }
+    }
+    if (idle > 0) {
+        max_welfare = std::max(max_welfare, 1.0);
+    }
+    total_fairness_ += max_welfare > 0 ? min_welfare / max_welfare : 1;
+    T_++;
+}
+
+void MetricAccumulator::add_quantum(std::vector<uint32_t>& demands, std::vector<uint32_t>& allocations,
+                                    std::vector<uint32_t>& payments, fi valuation) {
+    assert(demands.size() == N_ && allocations.size() == N_ && payments.size() == N_);
+    for (uint32_t i = 0; i < N_; ++i) {
+        total_used_ += std::min(demands[i], allocations[i]);
+        if (demands[i] > 0) {
+            double w = (double)std::min(demands[i], allocations[i]) * valuation(demands[i]) / payments[i];
+            valued_[i] += std::min((double)demands[i], w);
+            expected_[i] += demands[i];
         }
     }
-    return (double)used / (blocks * T);
+    total_fairness_ += instant_fairness(demands, allocations, payments, valuation, si_);
+    T_++;
+}
+
+uint64_t MetricAccumulator::get_num_quanta() {
+    return T_;
+}
+
+double MetricAccumulator::get_utilization(uint64_t blocks) {
+    assert(blocks > 0);
+    return (double)total_used_ / (blocks * T_);
+}
+
+std::vector<double> MetricAccumulator::get_welfares() {
+    std::vector<double> welfares(N_);
+    for (uint32_t i = 0; i < N_; ++i) {
+        welfares[i] = demanded_[i] > 0 ? (double)used_[i] / demanded_[i] : 1;
+    }
+    return welfares;
+}
+
+std::vector<double> MetricAccumulator::get_valued_welfares() {
+    std::vector<double> welfares(N_);
+    for (uint32_t i = 0; i < N_; ++i) {
+        welfares[i] = expected_[i] > 0 ? valued_[i] / expected_[i] : 1;
+    }
+    return welfares;
+}
+
+double MetricAccumulator::get_avg_fairness() {
+    return T_ > 0 ? total_fairness_ / T_ : 0;
 }
 
 double range_average(std::vector<double>& arr, size_t a, size_t b) {
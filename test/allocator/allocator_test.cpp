@@ -1,8 +1,22 @@
 #include <gtest/gtest.h>
 
+#include "bheap_test.h"
+#include "demand_inbox_test.h"
+#include "demand_source_test.h"
+#include "hierarchical_karma_test.h"
 #include "karma_test.h"
 #include "maxmin_test.h"
+#include "metrics_test.h"
+#include "pool_manager_test.h"
+#include "quantum_scheduler_test.h"
+#include "rng_test.h"
+#include "server_test.h"
+#include "sharp_test.h"
+#include "snowset_test.h"
+#include "sparse_test.h"
 #include "static_test.h"
+#include "stats_test.h"
+#include "trace_test.h"
 
 int main(int argc, char **argv) {
     testing::InitGoogleTest(&argc, argv);
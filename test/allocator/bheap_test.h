@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include "allocator/bheap.h"
+
+TEST(BroadcastHeapTest, PopOrderWithTies) {
+    BroadcastHeap h;
+    h.push(1, 3);
+    h.push(2, 1);
+    h.push(3, 3);
+    h.push(4, 2);
+    h.push(5, 1);
+
+    std::vector<bheap_item> expected = {{5, 1}, {2, 1}, {4, 2}, {3, 3}, {1, 3}};
+    for (const auto& item : expected) {
+        EXPECT_EQ(h.pop(), item);
+    }
+    EXPECT_TRUE(h.empty());
+}
+
+TEST(BroadcastHeapTest, BulkPushWithOffset) {
+    BroadcastHeap h;
+    h.push(1, 5);
+    h.add_all(-2);
+
+    std::vector<bheap_item> batch;
+    for (uint32_t k = 2; k < 40; ++k) {
+        batch.emplace_back(k, (k * 7) % 11);
+    }
+    h.push_all(batch.data(), batch.data() + batch.size());
+    batch.emplace_back(1, 3);
+    EXPECT_EQ(h.size(), batch.size());
+
+    std::sort(batch.begin(), batch.end(), [](const bheap_item& a, const bheap_item& b) {
+        return a.second < b.second || (a.second == b.second && a.first > b.first);
+    });
+    h.add_all(1);
+    for (const auto& [k, v] : batch) {
+        EXPECT_EQ(h.pop(), bheap_item(k, v + 1));
+    }
+
+    h.clear();
+    h.push(7, 4);
+    EXPECT_EQ(h.min(), 4);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "allocator/demand_inbox.h"
+#include "allocator/maxmin.h"
+
+TEST(DemandInboxTest, LatestReportWins) {
+    MaxMinAllocator alloc(1000);
+    DemandInbox inbox(4);
+    for (uint32_t id : {3, 70, 1000}) {
+        alloc.add_tenant(id);
+        inbox.add_tenant(id);
+    }
+
+    inbox.set_demand(70, 5, false);
+    inbox.set_demand(70, 9, false);
+    inbox.set_demand(1000, 2, false);
+    EXPECT_EQ(inbox.drain(alloc), 2);
+    EXPECT_EQ(inbox.drain(alloc), 0);
+    alloc.allocate();
+
+    EXPECT_EQ(alloc.get_allocation(3), 0);
+    EXPECT_EQ(alloc.get_allocation(70), 9);
+    EXPECT_EQ(alloc.get_allocation(1000), 2);
+
+    inbox.remove_tenant(70);
+    EXPECT_THROW(inbox.set_demand(70, 1, false), std::out_of_range);
+    EXPECT_THROW(inbox.set_demand(4, 1, false), std::out_of_range);
+}
+
+TEST(DemandInboxTest, ConcurrentProducers) {
+    uint32_t num_threads = 4, per_thread = 50, rounds = 2000;
+    MaxMinAllocator alloc(num_threads * per_thread * (rounds + per_thread));
+    DemandInbox inbox(num_threads * per_thread);
+    for (uint32_t id = 1; id <= num_threads * per_thread; ++id) {
+        alloc.add_tenant(id);
+        inbox.add_tenant(id);
+    }
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < num_threads; ++p) {
+        producers.emplace_back([&, p]() {
+            for (uint32_t r = 1; r <= rounds; ++r) {
+                for (uint32_t k = 1; k <= per_thread; ++k) {
+                    inbox.set_demand(p * per_thread + k, r + k, false);
+                }
+            }
+        });
+    }
+    for (uint32_t q = 0; q < 100; ++q) {
+        inbox.drain(alloc);
+        alloc.allocate();
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    inbox.drain(alloc);
+    alloc.allocate();
+    for (uint32_t p = 0; p < num_threads; ++p) {
+        for (uint32_t k = 1; k <= per_thread; ++k) {
+            EXPECT_EQ(alloc.get_allocation(p * per_thread + k), rounds + k);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "demand_source.h"
+
+TEST(DemandSourceTest, TextAndTraceAgree) {
+    std::ofstream("source_test.txt") << "5 1 9\n6 300 0\n2 2 2\n";
+    convert_text_trace("source_test.txt", "source_test.bin");
+
+    TextDemandSource text("source_test.txt", 3, 2);
+    auto trace = open_demand_source("source_test.bin", 3, 2);
+
+    std::vector<uint32_t> a, b;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (uint32_t t = 0; t < 2; ++t) {
+            ASSERT_TRUE(text.next(a));
+            ASSERT_TRUE(trace->next(b));
+            EXPECT_EQ(a, b);
+        }
+        EXPECT_FALSE(text.next(a));
+        EXPECT_FALSE(trace->next(b));
+        text.reset();
+        trace->reset();
+    }
+    EXPECT_EQ(b, std::vector<uint32_t>({6, 300, 0}));
+    std::remove("source_test.txt");
+    std::remove("source_test.bin");
+}
+
+TEST(DemandSourceTest, UniformReplaysAfterReset) {
+    UniformDemandSource source(50, 3, 10, 525);
+
+    matrix first;
+    std::vector<uint32_t> demands;
+    while (source.next(demands)) {
+        first.push_back(demands);
+    }
+    ASSERT_EQ(first.size(), 3);
+
+    source.reset();
+    MatrixDemandSource replay(first);
+    std::vector<uint32_t> expected;
+    while (replay.next(expected)) {
+        ASSERT_TRUE(source.next(demands));
+        EXPECT_EQ(demands, expected);
+    }
+}
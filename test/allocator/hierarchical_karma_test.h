@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "allocator/hierarchical_karma.h"
+#include "allocator/karma.h"
+
+TEST(HierarchicalKarmaTest, OneGroupMatchesFlat) {
+    KarmaAllocator flat(200, 0.5, 100);
+    HierarchicalKarmaAllocator hier(200, 0.5, 100, 1, 2);
+    for (uint32_t id = 1; id <= 20; ++id) {
+        flat.add_tenant(id);
+        hier.add_tenant(id);
+    }
+
+    std::mt19937 gen(19);
+    for (uint32_t t = 0; t < 50; ++t) {
+        if (t == 25) {
+            flat.remove_tenant(4);
+            hier.remove_tenant(4);
+        }
+        std::vector<uint32_t> demands(flat.get_num_tenants());
+        for (auto& d : demands) {
+            d = gen() % 25;
+        }
+        std::vector<bool> greedy(demands.size(), false);
+        flat.set_demands(demands, greedy);
+        hier.set_demands(demands, greedy);
+        flat.allocate();
+        hier.allocate();
+
+        std::vector<uint32_t> expected, actual;
+        flat.get_allocations(expected);
+        hier.get_allocations(actual);
+        ASSERT_EQ(actual, expected);
+    }
+    for (uint32_t id = 1; id <= 20; ++id) {
+        if (id != 4) {
+            EXPECT_EQ(hier.get_credits(id), flat.get_credits(id));
+        }
+    }
+}
+
+TEST(HierarchicalKarmaTest, GroupsAllocateIndependently) {
+    // Groups of 6, 3 and 3 tenants split 120 blocks 60/30/30
+    HierarchicalKarmaAllocator hier(120, 0.5, 100, 3, 2);
+    std::vector<std::unique_ptr<KarmaAllocator>> flat;
+    for (uint64_t blocks : {60, 30, 30}) {
+        flat.push_back(std::make_unique<KarmaAllocator>(blocks, 0.5, 100));
+    }
+
+    // Interleave groups so bulk positions differ from group positions
+    std::vector<uint32_t> groups = {0, 1, 0, 2, 0, 1, 0, 2, 0, 1, 0, 2};
+    for (uint32_t k = 0; k < groups.size(); ++k) {
+        hier.add_tenant(k + 1, groups[k]);
+        flat[groups[k]]->add_tenant(k + 1);
+    }
+    EXPECT_EQ(hier.get_group_allocator(0).get_num_blocks(), 60);
+    EXPECT_EQ(hier.get_group(4), 2);
+
+    std::mt19937 gen(7);
+    for (uint32_t t = 0; t < 30; ++t) {
+        std::vector<uint32_t> demands(groups.size());
+        for (uint32_t k = 0; k < groups.size(); ++k) {
+            demands[k] = gen() % 25;
+            flat[groups[k]]->set_demand(k + 1, demands[k], false);
+        }
+        hier.set_demands(demands, std::vector<bool>(groups.size(), false));
+        hier.allocate();
+
+        std::vector<uint32_t> allocations;
+        hier.get_allocations(allocations);
+        for (auto& group : flat) {
+            group->allocate();
+        }
+        for (uint32_t k = 0; k < groups.size(); ++k) {
+            ASSERT_EQ(allocations[k], flat[groups[k]]->get_allocation(k + 1));
+        }
+    }
+
+    EXPECT_THROW(hier.add_tenant(99, 3), std::out_of_range);
+    EXPECT_THROW(hier.get_allocation(99), std::out_of_range);
+}
+
+TEST(HierarchicalKarmaTest, RemovalKeepsBulkOrder) {
+    HierarchicalKarmaAllocator hier(100, 0, 100, 2, 1);
+    for (uint32_t id = 1; id <= 5; ++id) {
+        hier.add_tenant(id);
+    }
+
+    // The last tenant (5) moves into 2's position
+    hier.remove_tenant(2);
+    hier.set_demands({1, 2, 3, 4}, std::vector<bool>(4, false));
+    hier.allocate();
+    EXPECT_EQ(hier.get_allocation(1), 1);
+    EXPECT_EQ(hier.get_allocation(5), 2);
+    EXPECT_EQ(hier.get_allocation(3), 3);
+    EXPECT_EQ(hier.get_allocation(4), 4);
+
+    hier.remove_tenant(4);
+    std::vector<uint32_t> allocations;
+    hier.get_allocations(allocations);
+    EXPECT_EQ(allocations, std::vector<uint32_t>({1, 2, 3}));
+}
@@ -97,3 +97,124 @@ TEST(KarmaAllocatorTest, GuaranteeFairShareInsufficientCredits) {
     EXPECT_EQ(alloc.get_allocation(1), 3);
     EXPECT_EQ(alloc.get_allocation(2), 1);
 }
+
+TEST(KarmaAllocatorTest, BulkDemandsMatchPerTenant) {
+    KarmaAllocator bulk(8, 0.5, 10), single(8, 0.5, 10);
+    for (uint32_t id = 1; id <= 3; ++id) {
+        bulk.add_tenant(id);
+        single.add_tenant(id);
+    }
+
+    std::vector<uint32_t> demands = {0, 4, 1};
+    std::vector<bool> greedy = {true, false, false};
+    bulk.set_demands(demands, greedy);
+    for (uint32_t id = 1; id <= 3; ++id) {
+        single.set_demand(id, demands[id - 1], greedy[id - 1]);
+    }
+    bulk.allocate();
+    single.allocate();
+
+    std::vector<uint32_t> allocations;
+    bulk.get_allocations(allocations);
+    ASSERT_EQ(allocations.size(), 3);
+    for (uint32_t id = 1; id <= 3; ++id) {
+        EXPECT_EQ(allocations[id - 1], single.get_allocation(id));
+    }
+    EXPECT_THROW(bulk.set_demands({1, 2}, {false, false}), std::invalid_argument);
+}
+
+TEST(KarmaAllocatorTest, IncrementalMatchesFullRecompute) {
+    KarmaAllocator full(40, 0.5, 5), incremental(40, 0.5, 5);
+    incremental.set_incremental(true);
+    for (uint32_t id = 1; id <= 8; ++id) {
+        full.add_tenant(id);
+        incremental.add_tenant(id);
+    }
+
+    std::vector<uint32_t> demands(8, 0);
+    for (uint32_t t = 0; t < 50; ++t) {
+        demands[(t * 3) % 8] = (t * 7) % 11;
+        if (t % 5 == 0) {
+            demands[(t * 5 + 1) % 8] = 0;
+        }
+
+        for (uint32_t id = 1; id <= 8; ++id) {
+            full.set_demand(id, demands[id - 1], false);
+            incremental.set_demand(id, demands[id - 1], false);
+        }
+        full.allocate();
+        incremental.allocate();
+
+        for (uint32_t id = 1; id <= 8; ++id) {
+            EXPECT_EQ(incremental.get_allocation(id), full.get_allocation(id));
+            EXPECT_EQ(incremental.get_credits(id), full.get_credits(id));
+        }
+    }
+}
+
+TEST(KarmaAllocatorTest, JoinSeedsAverageCredits) {
+    KarmaAllocator alloc(12, 0.5, 10);
+    for (uint32_t id = 1; id <= 3; ++id) {
+        alloc.add_tenant(id);
+    }
+    for (uint32_t t = 0; t < 4; ++t) {
+        alloc.set_demand(1, 6, false);
+        alloc.set_demand(2, 0, false);
+        alloc.set_demand(3, t, false);
+        alloc.allocate();
+    }
+
+    auto average = [&](std::vector<uint32_t> ids) {
+        uint64_t total = 0;
+        for (uint32_t id : ids) {
+            total += alloc.get_credits(id);
+        }
+        return total / ids.size();
+    };
+    EXPECT_NE(alloc.get_credits(1), alloc.get_credits(2));
+
+    uint64_t expected = average({1, 2, 3});
+    alloc.add_tenant(4);
+    EXPECT_EQ(alloc.get_credits(4), expected);
+
+    alloc.set_demands({6, 0, 1, 2}, {false, false, false, false});
+    alloc.allocate();
+    alloc.remove_tenant(2);
+    expected = average({1, 3, 4});
+    alloc.add_tenant(5);
+    EXPECT_EQ(alloc.get_credits(5), expected);
+}
+
+TEST(KarmaAllocatorTest, ParallelMatchesSequential) {
+    const uint32_t N = 40000;
+    KarmaAllocator sequential(10 * N, 0.5, 20), parallel(10 * N, 0.5, 20);
+    parallel.set_num_threads(4);
+    EXPECT_THROW(parallel.set_num_threads(0), std::invalid_argument);
+    parallel.set_num_threads(4);
+    for (uint32_t id = 1; id <= N; ++id) {
+        sequential.add_tenant(id);
+        parallel.add_tenant(id);
+    }
+
+    std::vector<uint32_t> demands(N);
+    std::vector<bool> greedy(N, false);
+    std::vector<uint32_t> expected, actual;
+    for (uint32_t t = 0; t < 6; ++t) {
+        // Alternate between spare supply and excess demand
+        uint32_t spread = t % 2 == 0 ? 12 : 24;
+        for (uint32_t i = 0; i < N; ++i) {
+            demands[i] = (i * 7 + t * 13) % spread;
+        }
+        sequential.set_demands(demands, greedy);
+        parallel.set_demands(demands, greedy);
+        sequential.allocate();
+        parallel.allocate();
+
+        sequential.get_allocations(expected);
+        parallel.get_allocations(actual);
+        EXPECT_EQ(actual, expected);
+        for (uint32_t id = 1; id <= N; id += 97) {
+            EXPECT_EQ(parallel.get_credits(id), sequential.get_credits(id));
+        }
+    }
+}
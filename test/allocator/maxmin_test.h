@@ -43,3 +43,32 @@ TEST(MaxMinAllocatorTest, OverDemand) {
     EXPECT_EQ(alloc.get_allocation(2), 3);
     EXPECT_EQ(alloc.get_allocation(3), 1);
 }
+
+TEST(MaxMinAllocatorTest, BulkDemands) {
+    MaxMinAllocator alloc(6);
+    alloc.add_tenant(1);
+    alloc.add_tenant(2);
+    alloc.add_tenant(3);
+
+    alloc.set_demands({4, 3, 0}, {false, false, true});
+    alloc.allocate();
+
+    std::vector<uint32_t> allocations;
+    alloc.get_allocations(allocations);
+    EXPECT_EQ(allocations, std::vector<uint32_t>({2, 2, 2}));
+}
+
+TEST(MaxMinAllocatorTest, ZeroDemandOverDemand) {
+    MaxMinAllocator alloc(2);
+    alloc.add_tenant(1);
+    alloc.add_tenant(2);
+    alloc.add_tenant(3);
+    alloc.add_tenant(4);
+
+    alloc.set_demands({0, 3, 0, 2}, {false, false, false, false});
+    alloc.allocate();
+
+    std::vector<uint32_t> allocations;
+    alloc.get_allocations(allocations);
+    EXPECT_EQ(allocations, std::vector<uint32_t>({0, 1, 0, 1}));
+}
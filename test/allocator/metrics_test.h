@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "utils.h"
+
+TEST(MetricAccumulatorTest, MatchesMatrixMetrics) {
+    uint32_t N = 20, T = 50;
+    size_t si = 5;
+    std::mt19937 rng(525);
+    matrix demands(T, std::vector<uint32_t>(N)), allocations = demands, payments = demands;
+    for (uint32_t t = 0; t < T; ++t) {
+        for (uint32_t i = 0; i < N; ++i) {
+            demands[t][i] = rng() % 4 == 0 ? 0 : rng() % 30;
+            allocations[t][i] = rng() % 30;
+            payments[t][i] = 1 + rng() % 100;
+        }
+    }
+    fi valuation = [](uint32_t q) { return 50 + q; };
+
+    MetricAccumulator metrics(N, si), valued(N, si);
+    double total_fairness = 0, total_valued_fairness = 0;
+    for (uint32_t t = 0; t < T; ++t) {
+        metrics.add_quantum(demands[t], allocations[t]);
+        valued.add_quantum(demands[t], allocations[t], payments[t], valuation);
+        total_fairness += instant_fairness(demands[t], allocations[t], si);
+        total_valued_fairness += instant_fairness(demands[t], allocations[t], payments[t], valuation, si);
+    }
+
+    // Column-wise reference, as the matrix metrics were computed
+    uint64_t used = 0;
+    for (uint32_t i = 0; i < N; ++i) {
+        uint64_t tenant_used = 0, tenant_demand = 0;
+        double actual = 0, expected = 0;
+        for (uint32_t t = 0; t < T; ++t) {
+            used += std::min(demands[t][i], allocations[t][i]);
+            if (demands[t][i] > 0) {
+                tenant_used += std::min(demands[t][i], allocations[t][i]);
+                tenant_demand += demands[t][i];
+
+                double w = (double)std::min(demands[t][i], allocations[t][i]) * valuation(demands[t][i]) / payments[t][i];
+                actual += std::min((double)demands[t][i], w);
+                expected += demands[t][i];
+            }
+        }
+        EXPECT_EQ(metrics.get_welfares()[i], tenant_demand > 0 ? (double)tenant_used / tenant_demand : 1);
+        EXPECT_EQ(valued.get_valued_welfares()[i], expected > 0 ? actual / expected : 1);
+    }
+    EXPECT_EQ(metrics.get_utilization(100), (double)used / (100 * T));
+    EXPECT_EQ(metrics.get_avg_fairness(), total_fairness / T);
+    EXPECT_EQ(valued.get_avg_fairness(), total_valued_fairness / T);
+
+    EXPECT_EQ(welfares(demands, allocations), metrics.get_welfares());
+    EXPECT_EQ(welfares(demands, allocations, payments, valuation), valued.get_valued_welfares());
+    EXPECT_EQ(utilization(demands, allocations, 100), metrics.get_utilization(100));
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include "allocator/karma.h"
+#include "allocator/maxmin.h"
+#include "allocator/pool_manager.h"
+#include "allocator/static.h"
+
+TEST(PoolManagerTest, MatchesStandalonePools) {
+    PoolManager manager(3);
+    std::vector<std::unique_ptr<Allocator>> standalone;
+    for (uint32_t p = 0; p < 12; ++p) {
+        uint64_t blocks = 20 + p * 5;
+        if (p % 3 == 0) {
+            manager.emplace_pool<KarmaAllocator>(blocks, 0.5, 10);
+            standalone.push_back(std::make_unique<KarmaAllocator>(blocks, 0.5, 10));
+        } else if (p % 3 == 1) {
+            manager.emplace_pool<MaxMinAllocator>(blocks);
+            standalone.push_back(std::make_unique<MaxMinAllocator>(blocks));
+        } else {
+            manager.emplace_pool<StaticAllocator>(blocks);
+            standalone.push_back(std::make_unique<StaticAllocator>(blocks));
+        }
+        for (uint32_t id = 1; id <= 4 + p; ++id) {
+            manager.add_tenant(p, id);
+            standalone[p]->add_tenant(id);
+        }
+    }
+    EXPECT_EQ(manager.get_num_pools(), 12);
+
+    for (uint32_t t = 0; t < 10; ++t) {
+        for (uint32_t p = 0; p < manager.get_num_pools(); ++p) {
+            for (uint32_t id = 1; id <= 4 + p; ++id) {
+                uint32_t demand = (id * 7 + t * 3 + p) % 17;
+                manager.set_demand(p, id, demand, false);
+                standalone[p]->set_demand(id, demand, false);
+            }
+            standalone[p]->allocate();
+        }
+        manager.allocate();
+
+        for (uint32_t p = 0; p < manager.get_num_pools(); ++p) {
+            std::vector<uint32_t> expected, actual;
+            standalone[p]->get_allocations(expected);
+            manager.get_allocations(p, actual);
+            EXPECT_EQ(actual, expected);
+        }
+    }
+}
+
+TEST(PoolManagerTest, UnknownPool) {
+    PoolManager manager(2);
+    manager.emplace_pool<MaxMinAllocator>(10);
+
+    EXPECT_THROW(manager.add_tenant(1, 1), std::out_of_range);
+    EXPECT_THROW(manager.get_pool(1), std::out_of_range);
+    manager.allocate();
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "allocator/maxmin.h"
+#include "allocator/quantum_scheduler.h"
+#include "allocator/tenant_table.h"
+
+// Gives every tenant the number of quanta allocated so far, so any snapshot
+// mixing two quanta shows up as unequal allocations
+class QuantumCountAllocator : public Allocator {
+   public:
+    QuantumCountAllocator() : Allocator(0) {
+    }
+
+    void add_tenant(uint32_t id) {
+        tenants_.add(id);
+    }
+
+    void remove_tenant(uint32_t id) {
+        tenants_.remove(id);
+    }
+
+    void allocate() {
+        quanta_++;
+        std::fill(tenants_.allocations_.begin(), tenants_.allocations_.end(), quanta_);
+    }
+
+    void set_demand(uint32_t id, uint32_t demand, bool greedy) {
+    }
+
+    void set_demands(const std::vector<uint32_t>& demands, const std::vector<bool>& greedy) {
+    }
+
+    void get_allocations(std::vector<uint32_t>& allocations) {
+        allocations = tenants_.allocations_;
+    }
+
+    uint32_t get_fair_share() {
+        return 0;
+    }
+
+    uint32_t get_num_tenants() {
+        return tenants_.size();
+    }
+
+    uint32_t get_allocation(uint32_t id) {
+        return tenants_.allocations_[tenants_.find(id)];
+    }
+
+   private:
+    TenantTable tenants_;
+    uint32_t quanta_ = 0;
+};
+
+TEST(QuantumSchedulerTest, PublishesEachQuantum) {
+    MaxMinAllocator alloc(10);
+    QuantumScheduler sched(alloc, 8, std::chrono::milliseconds(1));
+    sched.add_tenant(1);
+    sched.add_tenant(2);
+    sched.add_tenant(3);
+
+    sched.set_demand(1, 2, false);
+    sched.set_demand(2, 8, false);
+    sched.set_demand(3, 8, false);
+    EXPECT_EQ(sched.get_allocation(2), 0);
+    sched.run_quantum();
+    EXPECT_EQ(sched.get_num_quanta(), 1);
+    EXPECT_EQ(sched.get_allocation(1), 2);
+    EXPECT_EQ(sched.get_allocation(2), 4);
+    EXPECT_EQ(sched.get_allocation(3), 4);
+
+    // Tenant 3 takes over tenant 1's position in the allocator
+    sched.remove_tenant(1);
+    sched.run_quantum();
+    std::vector<uint32_t> allocations;
+    EXPECT_EQ(sched.get_allocations({3, 2}, allocations), 2);
+    EXPECT_EQ(allocations, std::vector<uint32_t>({5, 5}));
+
+    EXPECT_THROW(sched.get_allocation(1), std::out_of_range);
+    EXPECT_THROW(sched.add_tenant(2), std::out_of_range);
+    EXPECT_THROW(sched.add_tenant(PUBLIC_ID), std::out_of_range);
+}
+
+TEST(QuantumSchedulerTest, SnapshotsUnderConcurrentAllocation) {
+    QuantumCountAllocator alloc;
+    QuantumScheduler sched(alloc, 64, std::chrono::microseconds(50));
+    std::vector<uint32_t> ids;
+    for (uint32_t id = 1; id <= 64; ++id) {
+        sched.add_tenant(id);
+        ids.push_back(id);
+    }
+
+    sched.start();
+    std::vector<std::thread> readers;
+    std::atomic<uint32_t> torn{0};
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&]() {
+            std::vector<uint32_t> allocations;
+            uint64_t last = 0;
+            while (last < 50) {
+                uint64_t q = sched.get_allocations(ids, allocations);
+                for (uint32_t a : allocations) {
+                    torn += a != q;
+                }
+                EXPECT_GE(q, last);
+                last = q;
+            }
+        });
+    }
+    for (auto& t : readers) {
+        t.join();
+    }
+    sched.stop();
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_GE(sched.get_num_quanta(), 50);
+}
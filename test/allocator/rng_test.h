@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include "allocator/sharp.h"
+#include "rng.h"
+#include "utils.h"
+
+TEST(PhiloxTest, KnownAnswers) {
+    EXPECT_EQ(Philox::block({0, 0, 0, 0}, {0, 0}),
+              Philox::counter({0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    EXPECT_EQ(Philox::block({UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX}, {UINT32_MAX, UINT32_MAX}),
+              Philox::counter({0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    EXPECT_EQ(Philox::block({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}),
+              Philox::counter({0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(PhiloxTest, DiscardSkipsAhead) {
+    Philox a(525, 3), b(525, 3);
+    for (uint64_t n : {0, 1, 3, 4, 9, 1000}) {
+        for (uint64_t k = 0; k < n; ++k) {
+            a();
+        }
+        b.discard(n);
+        EXPECT_EQ(a(), b());
+    }
+}
+
+TEST(PhiloxTest, StreamsAreIndependent) {
+    Philox a(525, 0), b(525, 1), c(526, 0);
+    uint32_t same_stream = 0, same_seed = 0;
+    for (int k = 0; k < 1000; ++k) {
+        uint32_t x = a();
+        same_stream += x == b();
+        same_seed += x == c();
+    }
+    EXPECT_LT(same_stream, 2);
+    EXPECT_LT(same_seed, 2);
+
+    a.seed(525, 1);
+    b.seed(525, 1);
+    for (int k = 0; k < 100; ++k) {
+        EXPECT_EQ(a(), b());
+    }
+}
+
+TEST(PhiloxTest, SeededLotteryIsReproducible) {
+    auto run = [](uint64_t seed) {
+        SharpAllocator alloc(10, 4, 2);
+        alloc.seed(seed);
+        for (uint32_t id = 1; id <= 8; ++id) {
+            alloc.add_tenant(id);
+        }
+
+        std::vector<uint32_t> allocations, history;
+        for (int t = 0; t < 20; ++t) {
+            alloc.set_demands(std::vector<uint32_t>(8, 5), std::vector<bool>(8, false));
+            alloc.allocate();
+            alloc.get_allocations(allocations);
+            history.insert(history.end(), allocations.begin(), allocations.end());
+        }
+        return history;
+    };
+    EXPECT_EQ(run(7), run(7));
+    EXPECT_NE(run(7), run(8));
+}
+
+TEST(PhiloxTest, BinomialMoments) {
+    Philox rng(525);
+    // Covers inversion (n * p < 10), BTRD, and the mirrored p > 0.5 branch
+    for (auto [n, p] : std::vector<std::pair<uint64_t, double>>{{20, 0.1}, {1000, 0.3}, {1000000, 0.5}, {500, 0.9}}) {
+        const int samples = 20000;
+        double sum = 0, sum_sq = 0;
+        for (int i = 0; i < samples; ++i) {
+            uint64_t k = sample_rand_binomial(rng, n, p);
+            ASSERT_LE(k, n);
+            sum += k;
+            sum_sq += (double)k * k;
+        }
+        double mean = sum / samples, var = sum_sq / samples - mean * mean;
+        double expected_var = n * p * (1 - p);
+        EXPECT_NEAR(mean, n * p, 5 * std::sqrt(expected_var / samples));
+        EXPECT_NEAR(var, expected_var, 0.1 * expected_var);
+    }
+    EXPECT_EQ(sample_rand_binomial(rng, 7, 0), 0);
+    EXPECT_EQ(sample_rand_binomial(rng, 7, 1), 7);
+}
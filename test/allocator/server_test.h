@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "allocator/maxmin.h"
+#include "client.h"
+#include "server.h"
+
+std::string test_socket_path() {
+    return "/tmp/alloctest_" + std::to_string(getpid()) + ".sock";
+}
+
+TEST(AllocServerTest, RoundTrip) {
+    MaxMinAllocator alloc(10);
+    QuantumScheduler sched(alloc, 8, std::chrono::milliseconds(1));
+    AllocServer server(sched, test_socket_path(), 2);
+    server.start();
+
+    AllocClient client(test_socket_path());
+    EXPECT_EQ(client.add_tenants({1, 2, 3, 2}), 1);
+    EXPECT_EQ(client.set_demands({{1, 2}, {2, 8}, {3, 8 | DEMAND_GREEDY}, {9, 1}}), 1);
+    sched.run_quantum();
+
+    std::vector<uint32_t> allocations;
+    EXPECT_EQ(client.get_allocations({1, 2, 3, 9}, allocations), 1);
+    EXPECT_EQ(allocations, std::vector<uint32_t>({2, 4, 4, NO_ALLOCATION}));
+
+    EXPECT_EQ(client.remove_tenants({1, 1}), 1);
+    EXPECT_EQ(server.get_num_updates(), 3);
+}
+
+TEST(AllocServerTest, PipelinedClients) {
+    MaxMinAllocator alloc(2500);
+    QuantumScheduler sched(alloc, 64, std::chrono::milliseconds(1));
+    AllocServer server(sched, test_socket_path(), 2);
+    server.start();
+
+    AllocClient setup(test_socket_path());
+    std::vector<uint32_t> ids;
+    for (uint32_t id = 1; id <= 20; ++id) {
+        ids.push_back(id);
+    }
+    ASSERT_EQ(setup.add_tenants(ids), 0);
+
+    // Each client owns ten tenants and streams increasing demands for them
+    std::vector<std::thread> clients;
+    for (uint32_t c = 0; c < 2; ++c) {
+        clients.emplace_back([&, c]() {
+            AllocClient client(test_socket_path());
+            std::vector<DemandUpdate> updates(10);
+            for (uint32_t r = 1; r <= 100; ++r) {
+                for (uint32_t k = 0; k < 10; ++k) {
+                    updates[k] = {c * 10 + k + 1, r + k};
+                }
+                client.send_request(MSG_SET_DEMANDS, updates.data(), updates.size());
+            }
+            for (uint32_t r = 1; r <= 100; ++r) {
+                EXPECT_EQ(client.recv_ack(), 0);
+            }
+        });
+    }
+    for (auto& t : clients) {
+        t.join();
+    }
+    sched.run_quantum();
+
+    std::vector<uint32_t> allocations;
+    setup.get_allocations(ids, allocations);
+    for (uint32_t k = 0; k < 20; ++k) {
+        EXPECT_EQ(allocations[k], 100 + k % 10);
+    }
+    EXPECT_EQ(server.get_num_updates(), 2000);
+}
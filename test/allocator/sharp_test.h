@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+
+#include "allocator/sharp.h"
+
+TEST(SharpAllocatorTest, TenantUnderDemand) {
+    SharpAllocator alloc(4, 1, 2);
+    alloc.add_tenant(1);
+    alloc.add_tenant(2);
+
+    alloc.set_demand(1, 1, false);
+    alloc.set_demand(2, 1, false);
+    alloc.allocate();
+
+    EXPECT_EQ(alloc.get_allocation(1), 1);
+    EXPECT_EQ(alloc.get_allocation(2), 1);
+}
+
+TEST(SharpAllocatorTest, OversubscribedLottery) {
+    SharpAllocator alloc(10, 2, 2);
+    for (uint32_t id = 1; id <= 4; ++id) {
+        alloc.add_tenant(id);
+    }
+
+    for (uint32_t id = 1; id <= 4; ++id) {
+        alloc.set_demand(id, 2 * id, false);
+    }
+    alloc.allocate();
+
+    uint32_t total = 0;
+    for (uint32_t id = 1; id <= 4; ++id) {
+        EXPECT_LE(alloc.get_allocation(id), 2 * id);
+        total += alloc.get_allocation(id);
+    }
+    EXPECT_EQ(total, 10);
+}
+
+TEST(SharpAllocatorTest, UnredeemedClaimsExpireAfterTerm) {
+    SharpAllocator alloc(4, 2, 3);
+    alloc.add_tenant(1);
+
+    // 8 tickets are granted but only 4 blocks exist, leaving a claim of 4
+    alloc.set_demand(1, 8, false);
+    alloc.allocate();
+    EXPECT_EQ(alloc.get_allocation(1), 4);
+    EXPECT_EQ(alloc.get_tickets(1), 4);
+    EXPECT_EQ(alloc.get_available_tickets(), 4);
+
+    alloc.set_demand(1, 0, false);
+    alloc.allocate();
+    EXPECT_EQ(alloc.get_tickets(1), 4);
+
+    // The claim granted in the first quantum expires at the end of the third
+    alloc.allocate();
+    EXPECT_EQ(alloc.get_tickets(1), 0);
+    EXPECT_EQ(alloc.get_available_tickets(), 8);
+}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "snowset.h"
+
+TEST(SnowsetLoaderTest, BinsRunningQueries) {
+    // 1519862400 is 2018-03-01 00:00:00 UTC
+    std::ofstream("snowset_test.csv") << "queryId,warehouseId,createdTime,durationTotal\n"
+                                         "1,\"7\",2018-03-01 00:00:00.500,1000\n"
+                                         "2,7,2018-03-01 00:00:01,0\n"
+                                         "3,8,2018-03-01 01:00:02+01,2500\r\n"
+                                         "4,8,\\N,10\n"
+                                         "5,9,2018-03-01 00:00:09,1000\n"
+                                         "6,7,1519862403.2,1000\n";
+
+    SnowsetLoader loader("snowset_test.csv");
+    matrix demands = loader.bin(1519862400, 1519862405, 1, 10, 0, 2);
+    EXPECT_EQ(loader.get_num_queries(), 4);
+    EXPECT_EQ(loader.get_num_skipped(), 1);
+    ASSERT_EQ(demands.size(), 5);
+    ASSERT_EQ(demands[0].size(), 2);
+
+    // Columns are in sampled order, so find each tenant by its total
+    uint32_t w7 = demands[0][0] == 1 ? 0 : 1, w8 = 1 - w7;
+    std::vector<uint32_t> expected7 = {1, 2, 0, 1, 1}, expected8 = {0, 0, 1, 1, 1};
+    for (uint32_t t = 0; t < 5; ++t) {
+        EXPECT_EQ(demands[t][w7], expected7[t]);
+        EXPECT_EQ(demands[t][w8], expected8[t]);
+    }
+
+    EXPECT_EQ(loader.bin(1519862400, 1519862405, 1, 1, 0, 1)[0].size(), 1);
+    EXPECT_THROW(SnowsetLoader("snowset_test.csv", "databaseId"), std::invalid_argument);
+    std::remove("snowset_test.csv");
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "allocator/hierarchical_karma.h"
+#include "allocator/karma.h"
+#include "allocator/maxmin.h"
+#include "allocator/static.h"
+#include "utils.h"
+
+// Runs the same mostly idle demands through the dense and sparse bulk calls,
+// with greedy tenants in the first positions, and compares every quantum
+template <typename A>
+void expect_sparse_matches_dense(A& dense, A& sparse, uint32_t N, uint32_t T) {
+    for (uint32_t id = 1; id <= N; ++id) {
+        dense.add_tenant(id);
+        sparse.add_tenant(id);
+    }
+    std::vector<bool> greedy(N, false);
+    greedy[0] = greedy[1] = true;
+
+    std::mt19937 gen(525);
+    std::vector<uint32_t> demands(N), dense_allocations, expected;
+    SparseRow row, allocations;
+    MetricAccumulator dense_metrics(N, 2), sparse_metrics(N, 2);
+    for (uint32_t t = 0; t < T; ++t) {
+        for (auto& d : demands) {
+            d = gen() % 8 == 0 ? gen() % 40 : 0;
+        }
+        row.clear();
+        for (uint32_t i = 0; i < N; ++i) {
+            if (greedy[i] || demands[i] > 0) {
+                row.push_back(i, demands[i]);
+            }
+        }
+
+        dense.set_demands(demands, greedy);
+        dense.allocate();
+        dense.get_allocations(dense_allocations);
+        sparse.set_sparse_demands(row, greedy);
+        sparse.allocate();
+        sparse.get_sparse_allocations(allocations);
+
+        ASSERT_EQ(allocations.pos_, row.pos_);
+        expected.clear();
+        for (uint32_t pos : row.pos_) {
+            expected.push_back(dense_allocations[pos]);
+        }
+        EXPECT_EQ(allocations.val_, expected);
+
+        dense_metrics.add_quantum(demands, dense_allocations);
+        sparse_metrics.add_quantum(row, allocations);
+    }
+    EXPECT_EQ(sparse_metrics.get_welfares(), dense_metrics.get_welfares());
+    EXPECT_EQ(sparse_metrics.get_utilization(dense.get_num_blocks()),
+              dense_metrics.get_utilization(dense.get_num_blocks()));
+    EXPECT_EQ(sparse_metrics.get_avg_fairness(), dense_metrics.get_avg_fairness());
+}
+
+TEST(SparseDemandsTest, MaxMinMatchesDense) {
+    MaxMinAllocator dense(200), sparse(200);
+    expect_sparse_matches_dense(dense, sparse, 40, 60);
+}
+
+TEST(SparseDemandsTest, KarmaMatchesDense) {
+    KarmaAllocator dense(200, 0.5, 20), sparse(200, 0.5, 20), incremental(200, 0.5, 20);
+    incremental.set_incremental(true);
+    expect_sparse_matches_dense(dense, sparse, 40, 60);
+
+    KarmaAllocator reference(200, 0.5, 20);
+    expect_sparse_matches_dense(reference, incremental, 40, 60);
+    for (uint32_t id = 1; id <= 40; ++id) {
+        EXPECT_EQ(incremental.get_credits(id), reference.get_credits(id));
+    }
+}
+
+TEST(SparseDemandsTest, StaticAndFallbackMatchDense) {
+    StaticAllocator dense(200), sparse(200);
+    expect_sparse_matches_dense(dense, sparse, 40, 20);
+
+    HierarchicalKarmaAllocator hdense(200, 0.5, 20, 4, 1), hsparse(200, 0.5, 20, 4, 1);
+    expect_sparse_matches_dense(hdense, hsparse, 40, 20);
+}
+
+TEST(SparseDemandsTest, LeavesSparseModeOnDenseUpdates) {
+    MaxMinAllocator alloc(10);
+    for (uint32_t id = 1; id <= 4; ++id) {
+        alloc.add_tenant(id);
+    }
+    SparseRow row, allocations;
+    row.push_back(1, 6);
+    alloc.set_sparse_demands(row, std::vector<bool>(4, false));
+    alloc.allocate();
+    EXPECT_EQ(alloc.get_allocation(2), 6);
+
+    alloc.set_demand(4, 8, false);
+    alloc.allocate();
+    EXPECT_EQ(alloc.get_allocation(4), 5);
+    EXPECT_EQ(alloc.get_allocation(2), 5);
+
+    row.clear();
+    row.push_back(0, 3);
+    alloc.set_sparse_demands(row, std::vector<bool>(4, false));
+    alloc.allocate();
+    alloc.get_sparse_allocations(allocations);
+    EXPECT_EQ(allocations.val_, std::vector<uint32_t>({3}));
+    EXPECT_EQ(alloc.get_allocation(2), 0);
+    EXPECT_EQ(alloc.get_allocation(4), 0);
+
+    row.push_back(3, 1);
+    EXPECT_THROW(alloc.set_sparse_demands(row, std::vector<bool>(3, false)), std::invalid_argument);
+
+    SparseRow unsorted, duplicate;
+    unsorted.push_back(3, 4);
+    unsorted.push_back(1, 4);
+    EXPECT_THROW(alloc.set_sparse_demands(unsorted, std::vector<bool>(4, false)), std::invalid_argument);
+    duplicate.push_back(2, 4);
+    duplicate.push_back(2, 4);
+    EXPECT_THROW(alloc.set_sparse_demands(duplicate, std::vector<bool>(4, false)), std::invalid_argument);
+}
@@ -40,3 +40,17 @@ TEST(StaticAllocatorTest, OverDemand) {
     EXPECT_EQ(alloc.get_allocation(1), 2);
     EXPECT_EQ(alloc.get_allocation(2), 2);
 }
+
+TEST(StaticAllocatorTest, BulkAllocations) {
+    StaticAllocator alloc(4);
+    alloc.add_tenant(1);
+    alloc.add_tenant(2);
+
+    alloc.set_demands({3, 1}, {false, false});
+    alloc.allocate();
+
+    std::vector<uint32_t> allocations;
+    alloc.get_allocations(allocations);
+    EXPECT_EQ(allocations, std::vector<uint32_t>({2, 2}));
+    EXPECT_THROW(alloc.set_demands({3}, {false}), std::invalid_argument);
+}
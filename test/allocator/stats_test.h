@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+
+#include "allocator/karma.h"
+
+TEST(AllocatorStatsTest, PhaseCounters) {
+    KarmaAllocator alloc(6, 0.5, 4);
+    alloc.add_tenant(1);
+    alloc.add_tenant(2);
+    alloc.add_tenant(3);
+
+    alloc.set_demands({0, 4, 4}, {false, false, false});
+    alloc.allocate();
+    alloc.allocate();
+
+    const auto& stats = alloc.get_stats();
+#ifdef ALLOC_STATS
+    EXPECT_EQ(stats.at("karma.classify.calls"), 2);
+    EXPECT_EQ(stats.at("karma.exchange.calls"), 2);
+    EXPECT_GT(stats.at("karma.exchange.cycles"), 0);
+    EXPECT_GT(stats.at("karma.heap_pushes"), 0);
+
+    alloc.reset_stats();
+    EXPECT_TRUE(alloc.get_stats().empty());
+#else
+    EXPECT_TRUE(stats.empty());
+#endif
+}
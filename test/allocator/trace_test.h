@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "trace.h"
+#include "utils.h"
+
+TEST(DemandTraceTest, BinaryRoundTrip) {
+    matrix demands = {{1, 300, 0}, {70000, 2, 5}};
+    write_trace("trace_test.bin", demands);
+
+    DemandTrace trace("trace_test.bin");
+    EXPECT_EQ(trace.get_num_tenants(), 3);
+    EXPECT_EQ(trace.get_num_quanta(), 2);
+    EXPECT_EQ(trace.get_width(), 4);
+
+    std::vector<uint32_t> row;
+    trace.row(1).copy_to(row);
+    EXPECT_EQ(row, demands[1]);
+    EXPECT_EQ(trace.row(0)[1], 300);
+    EXPECT_THROW(trace.row(2), std::out_of_range);
+    std::remove("trace_test.bin");
+}
+
+TEST(DemandTraceTest, DeltaRoundTrip) {
+    matrix demands = {{5, 1, 9}, {6, 300, 0}, {6, 70000, 0}, {UINT32_MAX, 0, 2}, {0, 1, 2}};
+    write_delta_trace("trace_test.bin", demands, 2);
+    EXPECT_FALSE(DemandTrace::is_trace("trace_test.bin"));
+
+    DeltaTrace trace("trace_test.bin");
+    EXPECT_EQ(trace.get_num_tenants(), 3);
+    EXPECT_EQ(trace.get_num_quanta(), 5);
+
+    DeltaTraceReader reader(trace);
+    std::vector<uint32_t> row;
+    for (auto& expected : demands) {
+        ASSERT_TRUE(reader.next(row));
+        EXPECT_EQ(row, expected);
+    }
+    EXPECT_FALSE(reader.next(row));
+
+    reader.seek(3);
+    ASSERT_TRUE(reader.next(row));
+    EXPECT_EQ(row, demands[3]);
+
+    char filename[] = "trace_test.bin";
+    EXPECT_EQ(read_demands(filename, 2, 3, false), matrix({{5, 1}, {6, 300}, {6, 70000}}));
+    std::remove("trace_test.bin");
+}
+
+TEST(DemandTraceTest, DeltaWriterAppendsRows) {
+    matrix demands = {{5, 1, 9}, {6, 300, 0}, {6, 300, 0}};
+    DeltaTraceWriter writer("trace_test.bin", 3, 3, 2);
+    writer.append(demands[0]);
+    EXPECT_THROW(writer.append({1, 2}), std::invalid_argument);
+    EXPECT_THROW(writer.close(), std::invalid_argument);
+    writer.append(demands[1]);
+    writer.append(demands[2]);
+    EXPECT_THROW(writer.append(demands[2]), std::out_of_range);
+    writer.close();
+
+    DeltaTrace trace("trace_test.bin");
+    EXPECT_EQ(trace.get_num_quanta(), 3);
+    DeltaTraceReader reader(trace);
+    std::vector<uint32_t> row;
+    for (auto& expected : demands) {
+        ASSERT_TRUE(reader.next(row));
+        EXPECT_EQ(row, expected);
+    }
+    std::remove("trace_test.bin");
+}
+
+TEST(DemandTraceTest, ConvertText) {
+    std::ofstream("trace_test.txt") << "5 1 9\n\n6 300 0\n";
+    convert_text_trace("trace_test.txt", "trace_test.bin");
+
+    DemandTrace trace("trace_test.bin");
+    EXPECT_EQ(trace.get_width(), 2);
+
+    char filename[] = "trace_test.bin";
+    matrix demands = read_demands(filename, 2, 2, false);
+    EXPECT_EQ(demands, matrix({{5, 1}, {6, 300}}));
+    std::remove("trace_test.txt");
+    std::remove("trace_test.bin");
+}
@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "allocator/karma.h"
+#include "allocator/maxmin.h"
+#include "allocator/mpsp.h"
+#include "allocator/sharp.h"
+#include "allocator/static.h"
+
+// Arguments: number of tenants, blocks per tenant (fair share) and demand
+// distribution. Every iteration is one quantum, so the Time column is the
+// cost per quantum and the per_tenant counter divides it by the tenant count.
+enum Distribution {
+    UNIFORM,  // demands uniform in [0, 2 * fair share]
+    SPARSE,   // like demands1: most tenants idle, a few far over fair share
+    OVER,     // every tenant over-demands, in [2, 4] x fair share
+};
+
+static const int NUM_ROWS = 8;
+
+uint32_t valuation(uint32_t q) {
+    return 100;
+}
+
+template <typename A>
+std::unique_ptr<A> make_allocator(uint64_t blocks);
+
+template <>
+std::unique_ptr<StaticAllocator> make_allocator(uint64_t blocks) {
+    return std::make_unique<StaticAllocator>(blocks);
+}
+
+template <>
+std::unique_ptr<MaxMinAllocator> make_allocator(uint64_t blocks) {
+    return std::make_unique<MaxMinAllocator>(blocks);
+}
+
+template <>
+std::unique_ptr<KarmaAllocator> make_allocator(uint64_t blocks) {
+    return std::make_unique<KarmaAllocator>(blocks, 0.5, 1000);
+}
+
+template <>
+std::unique_ptr<MPSPAllocator> make_allocator(uint64_t blocks) {
+    return std::make_unique<MPSPAllocator>(blocks, blocks / 2, valuation);
+}
+
+template <>
+std::unique_ptr<SharpAllocator> make_allocator(uint64_t blocks) {
+    return std::make_unique<SharpAllocator>(blocks, 2, 2);
+}
+
+matrix make_demands(uint32_t N, uint32_t fair_share, Distribution dist) {
+    std::mt19937 gen(525);
+    matrix demands(NUM_ROWS, std::vector<uint32_t>(N));
+    for (auto& row : demands) {
+        for (auto& d : row) {
+            if (dist == UNIFORM) {
+                d = gen() % (2 * fair_share + 1);
+            } else if (dist == SPARSE) {
+                d = gen() % 10 == 0 ? gen() % (20 * fair_share + 1) : 0;
+            } else {
+                d = 2 * fair_share + gen() % (2 * fair_share + 1);
+            }
+        }
+    }
+    return demands;
+}
+
+template <typename A>
+struct Fixture {
+    uint32_t N_;
+    std::unique_ptr<A> alloc_;
+    matrix demands_;
+    std::vector<bool> greedy_;
+
+    Fixture(benchmark::State& state)
+        : N_(state.range(0)), alloc_(make_allocator<A>((uint64_t)N_ * state.range(1))),
+          demands_(make_demands(N_, state.range(1), (Distribution)state.range(2))), greedy_(N_, false) {
+        for (uint32_t i = 1; i <= N_; ++i) {
+            alloc_->add_tenant(i);
+        }
+        alloc_->set_demands(demands_[0], greedy_);
+        alloc_->allocate();
+    }
+
+    void report(benchmark::State& state) {
+        state.SetItemsProcessed(state.iterations() * N_);
+        state.counters["per_tenant"] = benchmark::Counter(
+            state.iterations() * N_, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    }
+};
+
+template <typename A>
+void BM_Allocate(benchmark::State& state) {
+    Fixture<A> f(state);
+    size_t k = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        f.alloc_->set_demands(f.demands_[k++ % NUM_ROWS], f.greedy_);
+        state.ResumeTiming();
+
+        f.alloc_->allocate();
+    }
+    f.report(state);
+}
+
+template <typename A>
+void BM_SetDemand(benchmark::State& state) {
+    Fixture<A> f(state);
+    size_t k = 0;
+    for (auto _ : state) {
+        auto& row = f.demands_[k++ % NUM_ROWS];
+        for (uint32_t i = 1; i <= f.N_; ++i) {
+            f.alloc_->set_demand(i, row[i - 1], false);
+        }
+    }
+    f.report(state);
+}
+
+template <typename A>
+void BM_GetAllocation(benchmark::State& state) {
+    Fixture<A> f(state);
+    for (auto _ : state) {
+        uint64_t total = 0;
+        for (uint32_t i = 1; i <= f.N_; ++i) {
+            total += f.alloc_->get_allocation(i);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    f.report(state);
+}
+
+static void sweep(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"N", "fair", "dist"});
+    for (int64_t N = 10; N <= 1000000; N *= 10) {
+        for (int64_t fair : {4, 64}) {
+            for (int64_t dist : {UNIFORM, SPARSE, OVER}) {
+                b->Args({N, fair, dist});
+            }
+        }
+    }
+    b->Unit(benchmark::kMicrosecond);
+}
+
+#define ALLOCATOR_BENCHMARKS(A)                        \
+    BENCHMARK_TEMPLATE(BM_Allocate, A)->Apply(sweep);  \
+    BENCHMARK_TEMPLATE(BM_SetDemand, A)->Apply(sweep); \
+    BENCHMARK_TEMPLATE(BM_GetAllocation, A)->Apply(sweep);
+
+ALLOCATOR_BENCHMARKS(StaticAllocator)
+ALLOCATOR_BENCHMARKS(MaxMinAllocator)
+ALLOCATOR_BENCHMARKS(KarmaAllocator)
+ALLOCATOR_BENCHMARKS(MPSPAllocator)
+ALLOCATOR_BENCHMARKS(SharpAllocator)
+
+BENCHMARK_MAIN();
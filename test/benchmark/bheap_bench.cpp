@@ -0,0 +1,107 @@
+#include <chrono>
+#include <cstdio>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "allocator/bheap.h"
+
+// The std::priority_queue heap that allocate() built fresh every quantum
+// before BroadcastHeap became reusable, kept here as the baseline.
+class LegacyHeap {
+   public:
+    void push(uint32_t key, int32_t val) {
+        h_.push(std::make_pair(key, val - base_val_));
+    }
+
+    bheap_item pop() {
+        auto i = h_.top();
+        h_.pop();
+        return std::make_pair(i.first, i.second + base_val_);
+    }
+
+    int32_t min() {
+        return h_.top().second + base_val_;
+    }
+
+    void add_all(int32_t delta) {
+        base_val_ += delta;
+    }
+
+    size_t size() {
+        return h_.size();
+    }
+
+    bool empty() {
+        return h_.empty();
+    }
+
+   private:
+    struct cmp {
+        bool operator()(const bheap_item& a, const bheap_item& b) {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        }
+    };
+
+    std::priority_queue<bheap_item, std::vector<bheap_item>, cmp> h_;
+    int32_t base_val_ = 0;
+};
+
+// One water-filling pass: load every item, then raise the level until half
+// of the items have saturated and pop the rest
+template <typename Heap>
+uint64_t drain(Heap& h) {
+    uint64_t checksum = 0;
+    size_t target = h.size() / 2;
+    while (h.size() > target) {
+        h.add_all(-h.min());
+        while (!h.empty() && h.min() == 0) {
+            checksum += h.pop().first;
+        }
+    }
+    while (!h.empty()) {
+        auto [k, v] = h.pop();
+        checksum += k ^ v;
+    }
+    return checksum;
+}
+
+int main(int argc, char** argv) {
+    uint32_t n = argc > 1 ? std::stoul(argv[1]) : 100000;
+    uint32_t rounds = argc > 2 ? std::stoul(argv[2]) : 50;
+
+    std::mt19937 gen(525);
+    std::vector<bheap_item> items;
+    for (uint32_t k = 0; k < n; ++k) {
+        items.emplace_back(k, gen() % 64);
+    }
+
+    uint64_t legacy_sum = 0, reused_sum = 0;
+    double legacy_ms = 0, reused_ms = 0;
+
+    BroadcastHeap reused;
+    for (uint32_t r = 0; r < rounds; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        LegacyHeap legacy;
+        for (const auto& [k, v] : items) {
+            legacy.push(k, v);
+        }
+        legacy_sum += drain(legacy);
+        auto mid = std::chrono::steady_clock::now();
+
+        reused.clear();
+        reused.push_all(items.data(), items.data() + items.size());
+        reused_sum += drain(reused);
+        auto end = std::chrono::steady_clock::now();
+
+        legacy_ms += std::chrono::duration<double, std::milli>(mid - start).count();
+        reused_ms += std::chrono::duration<double, std::milli>(end - mid).count();
+    }
+
+    if (legacy_sum != reused_sum) {
+        fprintf(stderr, "checksum mismatch: %lu != %lu\n", legacy_sum, reused_sum);
+        return 1;
+    }
+    printf("N=%u legacy %.3f ms/round, reused 4-ary %.3f ms/round\n", n, legacy_ms / rounds, reused_ms / rounds);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "allocator/karma.h"
+#include "allocator/quantum_scheduler.h"
+
+typedef std::chrono::steady_clock steady_clock;
+
+// Keeps a value the compiler would otherwise drop, as benchmark::DoNotOptimize
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Read latency of get_allocation() while a Karma allocator runs a quantum
+// every period and one producer keeps reporting demands. The locked
+// baseline is how the allocator had to be shared before: one mutex around
+// every call, held for the whole of allocate().
+struct Config {
+    uint32_t N_, fair_share_, num_readers_;
+    std::chrono::microseconds quantum_;
+    std::chrono::milliseconds duration_;
+};
+
+template <typename Read, typename Write, typename Tick>
+std::vector<double> measure(const Config& cfg, Read read, Write write, Tick tick) {
+    std::atomic<bool> done{false};
+
+    std::thread ticker([&]() {
+        auto next = steady_clock::now();
+        while (!done) {
+            next += cfg.quantum_;
+            std::this_thread::sleep_until(next);
+            tick();
+        }
+    });
+    std::thread producer([&]() {
+        std::mt19937 gen(7);
+        while (!done) {
+            write(gen() % cfg.N_ + 1, gen() % (4 * cfg.fair_share_));
+        }
+    });
+
+    std::vector<std::vector<double>> samples(cfg.num_readers_);
+    std::vector<std::thread> readers;
+    for (uint32_t r = 0; r < cfg.num_readers_; ++r) {
+        readers.emplace_back([&, r]() {
+            std::mt19937 gen(r);
+            while (!done) {
+                uint32_t id = gen() % cfg.N_ + 1;
+                auto start = steady_clock::now();
+                do_not_optimize(read(id));
+                auto end = steady_clock::now();
+                samples[r].push_back(std::chrono::duration<double, std::nano>(end - start).count());
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(cfg.duration_);
+    done = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+    producer.join();
+    ticker.join();
+
+    std::vector<double> all;
+    for (auto& s : samples) {
+        all.insert(all.end(), s.begin(), s.end());
+    }
+    std::sort(all.begin(), all.end());
+    return all;
+}
+
+void report(const char* label, const std::vector<double>& ns) {
+    auto pct = [&](double p) { return ns[std::min(ns.size() - 1, (size_t)(p * ns.size()))]; };
+    printf("%-10s reads=%zu p50=%.0f ns p99=%.0f ns p99.9=%.0f ns max=%.0f ns\n",
+           label, ns.size(), pct(0.5), pct(0.99), pct(0.999), ns.back());
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
+    cfg.N_ = argc > 1 ? std::stoul(argv[1]) : 100000;
+    cfg.num_readers_ = argc > 2 ? std::stoul(argv[2]) : 2;
+    cfg.quantum_ = std::chrono::microseconds(argc > 3 ? std::stoul(argv[3]) : 10000);
+    cfg.duration_ = std::chrono::milliseconds(argc > 4 ? std::stoul(argv[4]) : 2000);
+    cfg.fair_share_ = 8;
+    uint64_t blocks = (uint64_t)cfg.N_ * cfg.fair_share_;
+
+    {
+        KarmaAllocator alloc(blocks, 0.5, 1000);
+        std::mutex mutex;
+        for (uint32_t id = 1; id <= cfg.N_; ++id) {
+            alloc.add_tenant(id);
+        }
+        auto ns = measure(
+            cfg,
+            [&](uint32_t id) {
+                std::lock_guard<std::mutex> lock(mutex);
+                return alloc.get_allocation(id);
+            },
+            [&](uint32_t id, uint32_t demand) {
+                std::lock_guard<std::mutex> lock(mutex);
+                alloc.set_demand(id, demand, false);
+            },
+            [&]() {
+                std::lock_guard<std::mutex> lock(mutex);
+                alloc.allocate();
+            });
+        report("locked", ns);
+    }
+
+    {
+        KarmaAllocator alloc(blocks, 0.5, 1000);
+        QuantumScheduler sched(alloc, cfg.N_, cfg.quantum_);
+        for (uint32_t id = 1; id <= cfg.N_; ++id) {
+            sched.add_tenant(id);
+        }
+        // measure() drives the quanta itself so both modes tick the same way
+        auto ns = measure(
+            cfg, [&](uint32_t id) { return sched.get_allocation(id); },
+            [&](uint32_t id, uint32_t demand) { sched.set_demand(id, demand, false); },
+            [&]() { sched.run_quantum(); });
+        report("seqlock", ns);
+        printf("quanta=%lu\n", sched.get_num_quanta());
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <signal.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "allocator/karma.h"
+#include "allocator/maxmin.h"
+#include "allocator/mpsp.h"
+#include "allocator/sharp.h"
+#include "allocator/static.h"
+#include "server.h"
+
+uint32_t valuation(uint32_t q) {
+    return 100;
+}
+
+std::unique_ptr<Allocator> make_allocator(const std::string& name, uint64_t blocks) {
+    if (name == "static") {
+        return std::make_unique<StaticAllocator>(blocks);
+    } else if (name == "maxmin") {
+        return std::make_unique<MaxMinAllocator>(blocks);
+    } else if (name == "karma") {
+        return std::make_unique<KarmaAllocator>(blocks, 0.5, 1000);
+    } else if (name == "mpsp") {
+        return std::make_unique<MPSPAllocator>(blocks, blocks / 2, valuation);
+    } else if (name == "sharp") {
+        return std::make_unique<SharpAllocator>(blocks, 2, 2);
+    }
+    throw std::invalid_argument("unknown allocator " + name);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "usage: socket_path static|maxmin|karma|mpsp|sharp num_blocks "
+                  << "[max_tenants] [quantum_us] [io_threads]" << std::endl;
+        return 0;
+    }
+    std::string path = argv[1];
+    uint64_t blocks = std::stoull(argv[3]);
+    uint32_t capacity = argc > 4 ? std::stoul(argv[4]) : 1000000;
+    auto quantum = std::chrono::microseconds(argc > 5 ? std::stoul(argv[5]) : 100000);
+    uint32_t num_threads = argc > 6 ? std::stoul(argv[6]) : 2;
+
+    // Handle SIGINT and SIGTERM synchronously on the main thread
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    auto alloc = make_allocator(argv[2], blocks);
+    QuantumScheduler sched(*alloc, capacity, quantum);
+    AllocServer server(sched, path, num_threads);
+    sched.start();
+    server.start();
+    std::cout << "serving " << argv[2] << " on " << path << std::endl;
+
+    int sig;
+    sigwait(&signals, &sig);
+    server.stop();
+    sched.stop();
+
+    std::cout << "updates=" << server.get_num_updates() << " quanta=" << sched.get_num_quanta()
+              << " overruns=" << sched.get_num_overruns() << std::endl;
+}
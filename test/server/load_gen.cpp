@@ -0,0 +1,91 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client.h"
+
+// Drives an AllocServer with batched demand updates from several connections,
+// each keeping a window of requests in flight, and reports updates per second
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: socket_path [tenants] [clients] [batch] [window] [seconds]\n");
+        return 0;
+    }
+    std::string path = argv[1];
+    uint32_t N = argc > 2 ? std::stoul(argv[2]) : 100000;
+    uint32_t num_clients = argc > 3 ? std::stoul(argv[3]) : 2;
+    uint32_t batch = argc > 4 ? std::stoul(argv[4]) : 1024;
+    uint32_t window = argc > 5 ? std::stoul(argv[5]) : 8;
+    double seconds = argc > 6 ? std::stod(argv[6]) : 5;
+
+    {
+        AllocClient setup(path);
+        std::vector<uint32_t> ids;
+        for (uint32_t id = 1; id <= N; ++id) {
+            ids.push_back(id);
+            if (ids.size() == MSG_MAX_RECORDS || id == N) {
+                uint32_t rejected = setup.add_tenants(ids);
+                if (rejected > 0) {
+                    fprintf(stderr, "warning: %u tenants already existed\n", rejected);
+                }
+                ids.clear();
+            }
+        }
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> total_updates{0}, total_rejected{0};
+    std::vector<std::thread> clients;
+    for (uint32_t c = 0; c < num_clients; ++c) {
+        clients.emplace_back([&, c]() {
+            AllocClient client(path);
+            std::mt19937 gen(c);
+            std::vector<std::vector<DemandUpdate>> batches(16, std::vector<DemandUpdate>(batch));
+            for (auto& b : batches) {
+                for (auto& u : b) {
+                    u.id_ = gen() % N + 1;
+                    u.demand_ = gen() % 64;
+                }
+            }
+
+            uint64_t sent = 0, acked = 0, rejected = 0;
+            while (!done) {
+                if (sent - acked == window) {
+                    rejected += client.recv_ack();
+                    acked++;
+                }
+                client.send_request(MSG_SET_DEMANDS, batches[sent % batches.size()].data(), batch);
+                sent++;
+            }
+            while (acked < sent) {
+                rejected += client.recv_ack();
+                acked++;
+            }
+            total_updates += acked * batch - rejected;
+            total_rejected += rejected;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    done = true;
+    for (auto& t : clients) {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    AllocClient reader(path);
+    std::vector<uint32_t> ids(std::min(N, 1024u)), allocations;
+    for (uint32_t k = 0; k < ids.size(); ++k) {
+        ids[k] = k + 1;
+    }
+    uint64_t quantum = reader.get_allocations(ids, allocations);
+
+    printf("updates=%lu rejected=%lu elapsed=%.2f s rate=%.2f M updates/s quantum=%lu\n", total_updates.load(),
+           total_rejected.load(), elapsed, total_updates / elapsed / 1e6, quantum);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <vector>
+
+#include "allocator/hierarchical_karma.h"
+#include "allocator/karma.h"
+#include "allocator/mpsp.h"
+#include "allocator/sharp.h"
+#include "utils.h"
+
+// Mechanism-specific metrics for Simulation::simulate(). record() sees every
+// quantum and feeds the welfare metrics; finish() fills the per-tenant proxy
+// (credits, payments, tickets) at the end of the run. The default policy has
+// no proxy. Sparse policies are fed sparse rows, which lets allocators skip
+// idle tenants; the others read dense per-tenant state every quantum.
+template <typename A>
+struct ProxyPolicy {
+    static constexpr bool has_proxy = false, valued = false, sparse = true;
+
+    ProxyPolicy(uint32_t N) {
+    }
+
+    void record(A& alloc, MetricAccumulator& metrics, std::vector<uint32_t>& demand,
+                std::vector<uint32_t>& allocation) {
+        metrics.add_quantum(demand, allocation);
+    }
+
+    void record(A& alloc, MetricAccumulator& metrics, SparseRow& demand, SparseRow& allocation) {
+        metrics.add_quantum(demand, allocation);
+    }
+
+    void finish(A& alloc, uint32_t T, std::vector<double>& proxy) {
+    }
+};
+
+// User credits after the last quantum
+template <typename A>
+struct CreditProxyPolicy {
+    static constexpr bool has_proxy = true, valued = false, sparse = true;
+
+    CreditProxyPolicy(uint32_t N) {
+    }
+
+    void record(A& alloc, MetricAccumulator& metrics, std::vector<uint32_t>& demand,
+                std::vector<uint32_t>& allocation) {
+        metrics.add_quantum(demand, allocation);
+    }
+
+    void record(A& alloc, MetricAccumulator& metrics, SparseRow& demand, SparseRow& allocation) {
+        metrics.add_quantum(demand, allocation);
+    }
+
+    void finish(A& alloc, uint32_t T, std::vector<double>& proxy) {
+        for (uint32_t i = 1; i <= proxy.size(); ++i) {
+            proxy[i - 1] = alloc.get_credits(i);
+        }
+    }
+};
+
+template <>
+struct ProxyPolicy<KarmaAllocator> : CreditProxyPolicy<KarmaAllocator> {
+    using CreditProxyPolicy::CreditProxyPolicy;
+};
+
+template <>
+struct ProxyPolicy<HierarchicalKarmaAllocator> : CreditProxyPolicy<HierarchicalKarmaAllocator> {
+    using CreditProxyPolicy::CreditProxyPolicy;
+};
+
+// Average winning payment; welfare is weighed by valuation over payment
+template <>
+struct ProxyPolicy<MPSPAllocator> {
+    static constexpr bool has_proxy = true, valued = true, sparse = false;
+
+    std::vector<uint32_t> payment_, wins_;
+    std::vector<double> paid_;
+
+    ProxyPolicy(uint32_t N) : payment_(N), wins_(N, 0), paid_(N, 0) {
+    }
+
+    void record(MPSPAllocator& alloc, MetricAccumulator& metrics, std::vector<uint32_t>& demand,
+                std::vector<uint32_t>& allocation) {
+        alloc.get_payments(payment_);
+        for (uint32_t i = 0; i < payment_.size(); ++i) {
+            if (payment_[i] > 0) {
+                paid_[i] += payment_[i];
+                wins_[i]++;
+            }
+        }
+        metrics.add_quantum(demand, allocation, payment_, alloc.get_valuation());
+    }
+
+    void finish(MPSPAllocator& alloc, uint32_t T, std::vector<double>& proxy) {
+        for (uint32_t i = 0; i < proxy.size(); ++i) {
+            proxy[i] = paid_[i] / wins_[i];
+        }
+    }
+};
+
+// Average tickets held after each quantum
+template <>
+struct ProxyPolicy<SharpAllocator> {
+    static constexpr bool has_proxy = true, valued = false, sparse = false;
+
+    std::vector<uint32_t> tickets_;
+    std::vector<double> held_;
+
+    ProxyPolicy(uint32_t N) : tickets_(N), held_(N, 0) {
+    }
+
+    void record(SharpAllocator& alloc, MetricAccumulator& metrics, std::vector<uint32_t>& demand,
+                std::vector<uint32_t>& allocation) {
+        alloc.get_tickets(tickets_);
+        for (uint32_t i = 0; i < tickets_.size(); ++i) {
+            held_[i] += tickets_[i];
+        }
+        metrics.add_quantum(demand, allocation);
+    }
+
+    void finish(SharpAllocator& alloc, uint32_t T, std::vector<double>& proxy) {
+        for (uint32_t i = 0; i < proxy.size(); ++i) {
+            proxy[i] = held_[i] / T;
+        }
+    }
+};
@@ -0,0 +1,34 @@
+#include "sim_runner.h"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+#include "allocator/thread_pool.h"
+
+SimRunner::SimRunner(uint32_t N, uint32_t T, uint64_t seed, source_factory make_source)
+    : N_(N), T_(T), seed_(seed), make_source_(make_source) {
+}
+
+void SimRunner::add_job(std::string label, int sigma, job_fn run) {
+    jobs_.push_back({label, run, Simulation(N_, T_, sigma)});
+}
+
+void SimRunner::run(uint32_t num_threads) {
+    ThreadPool pool(std::max(num_threads, 1u));
+    std::mutex progress;
+    pool.run(jobs_.size(), [&](size_t i) {
+        auto& job = jobs_[i];
+        auto demands = make_source_();
+        job.run_(job.sim_, *demands, seed_, i + 1);
+
+        std::lock_guard<std::mutex> lock(progress);
+        std::cout << "sigma=" << job.sim_.sigma_ << " " << job.label_ << std::endl;
+    });
+}
+
+void SimRunner::output_sim(std::ostream& out) {
+    for (auto& job : jobs_) {
+        job.sim_.output_sim(out, job.label_);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+// Runs independent (allocator, sigma) simulations in parallel. Every job gets
+// its own allocator, Simulation and demand source over the same trace;
+// results are written in the order the jobs were added. Job k's allocator
+// draws from stream k + 1 of the run seed, leaving stream 0 to the demand
+// source, so a run is reproducible from its seed on any number of threads.
+class SimRunner {
+   public:
+    typedef std::function<std::unique_ptr<DemandSource>()> source_factory;
+    typedef std::function<void(Simulation&, DemandSource&, uint64_t seed, uint64_t stream)> job_fn;
+
+    SimRunner(uint32_t N, uint32_t T, uint64_t seed, source_factory make_source);
+
+    void add_job(std::string label, int sigma, job_fn run);
+
+    // Constructs the allocator on the worker thread that runs the job
+    template <typename A, typename... Args>
+    void add_job(std::string label, int sigma, Args... args) {
+        add_job(label, sigma, [=](Simulation& s, DemandSource& demands, uint64_t seed, uint64_t stream) {
+            A alloc(args...);
+            alloc.seed(seed, stream);
+            s.simulate(alloc, demands);
+        });
+    }
+
+    void run(uint32_t num_threads);
+
+    void output_sim(std::ostream& out);
+
+   private:
+    struct Job {
+        std::string label_;
+        job_fn run_;
+        Simulation sim_;
+    };
+
+    uint32_t N_, T_;
+    uint64_t seed_;
+    source_factory make_source_;
+    std::vector<Job> jobs_;
+};
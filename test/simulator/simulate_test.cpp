@@ -1,69 +1,55 @@
+#include <algorithm>
 #include <fstream>
+#include <thread>
 #include <vector>
 
+#include "allocator/hierarchical_karma.h"
 #include "allocator/karma.h"
 #include "allocator/maxmin.h"
 #include "allocator/mpsp.h"
 #include "allocator/sharp.h"
 #include "allocator/static.h"
-#include "simulation.h"
+#include "sim_runner.h"
 #include "utils.h"
 
 uint32_t valuation(uint32_t q) {
     return 100;
 }
 
-void output_sim(Simulation& s, std::ofstream& out, std::string label) {
-    s.output_sim(out, label);
-    std::cout << label << " ";
-    std::cout.flush();
-}
-
 int main(int argc, char** argv) {
-    if (argc < 4 || argc > 5) {
+    if (argc < 4 || argc > 6) {
         std::cerr << "usage: num_blocks num_tenants num_quanta" << std::endl;
-        std::cerr << "       num_blocks num_tenants num_quanta demands_filename" << std::endl;
+        std::cerr << "       num_blocks num_tenants num_quanta demands_filename|- [seed]" << std::endl;
         return 0;
     }
 
     uint32_t B = std::atoi(argv[1]), N = std::atoi(argv[2]), T = std::atoi(argv[3]);
     uint32_t fair_share = B / N;
 
-    matrix demands;
-    if (argc == 4) {
-        demands = generate_uniform_demands(N, T, fair_share * 2);
-    } else {
-        demands = read_demands(argv[4], N, T, false);
-    }
-    assert(demands.size() == T && demands[0].size() == N);
+    std::string filename = argc >= 5 && std::string(argv[4]) != "-" ? argv[4] : "";
+    uint64_t seed = argc == 6 ? std::strtoull(argv[5], nullptr, 10) : random_seed();
+    std::cout << "seed " << seed << std::endl;
 
-    std::ofstream sim_out("test/simulator/out/sim.csv");
+    SimRunner runner(N, T, seed, [=]() -> std::unique_ptr<DemandSource> {
+        if (filename.empty()) {
+            return std::make_unique<UniformDemandSource>(N, T, fair_share * 2, seed);
+        }
+        return open_demand_source(filename, N, T);
+    });
     for (int sigma = 0; sigma <= 100; sigma += 20) {
-        std::cout << "sigma=" << sigma << ": ";
-        std::cout.flush();
-
-        StaticAllocator static_alloc(B);
-        MaxMinAllocator maxmin_alloc(B);
-        KarmaAllocator karma(B, 1, B * T);
-        MPSPAllocator mpsp(B, 0, valuation);
-        SharpAllocator sharp(B, 2, 2);
-        Simulation s(N, T, sigma);
-
-        s.simulate(static_alloc, demands);
-        output_sim(s, sim_out, "static");
-
-        s.simulate(maxmin_alloc, demands);
-        output_sim(s, sim_out, "maxmin");
-
-        s.simulate(karma, demands);
-        output_sim(s, sim_out, "karma");
+        runner.add_job<StaticAllocator>("static", sigma, B);
+        runner.add_job<MaxMinAllocator>("maxmin", sigma, B);
+        runner.add_job<KarmaAllocator>("karma", sigma, B, 1, B * T);
+        runner.add_job<HierarchicalKarmaAllocator>("hkarma", sigma, B, 1, B * T, 10, 1);
+        runner.add_job<MPSPAllocator>("mpsp", sigma, B, 0, valuation);
+        runner.add_job<SharpAllocator>("sharp", sigma, B, 2, 2);
+    }
 
-        s.simulate(mpsp, demands);
-        output_sim(s, sim_out, "mpsp");
+    uint32_t num_threads = std::thread::hardware_concurrency();
+    std::cout << "running on " << std::max(num_threads, 1u) << " threads" << std::endl;
+    runner.run(num_threads);
 
-        s.simulate(sharp, demands);
-        output_sim(s, sim_out, "sharp");
-        std::cout << std::endl;
-    }
+    std::ofstream sim_out("test/simulator/out/sim.csv");
+    runner.output_sim(sim_out);
     sim_out.close();
-}
\ No newline at end of file
+}
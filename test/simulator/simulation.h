@@ -1,9 +1,12 @@
+#pragma once
+
+#include <algorithm>
 #include <functional>
 #include <vector>
 
-#include "allocator/karma.h"
-#include "allocator/mpsp.h"
-#include "allocator/sharp.h"
+#include "demand_source.h"
+#include "proxy_policy.h"
+#include "utils.h"
 
 typedef std::vector<std::vector<uint32_t>> matrix;
 
@@ -11,7 +14,7 @@ struct Simulation {
     uint32_t N_, T_;
     int sigma_;
 
-    std::vector<double> welfares_, instant_fairness_, proxy_;
+    std::vector<double> welfares_, proxy_;
 
     double utilization_ = 0, avg_fairness_ = 0, fairness_ = 0;
     double avg_welfare_ = 0, incentive_ = 0;
@@ -19,13 +22,67 @@ struct Simulation {
 
     Simulation(uint32_t N, uint32_t T, int sigma);
 
-    void simulate(Allocator& alloc, matrix& demands);
+    // A is the concrete allocator type, so calls in the loop bind statically
+    template <typename A, typename Policy = ProxyPolicy<A>>
+    void simulate(A& alloc, DemandSource& demands);
+
+    void output_sim(std::ostream& out, std::string label);
 
-    void simulate(KarmaAllocator& alloc, matrix& demands);
+   private:
+    void start(Allocator& alloc, DemandSource& demands);
 
-    void simulate(MPSPAllocator& alloc, matrix& demands);
+    void next_quantum(DemandSource& source, std::vector<uint32_t>& demands);
 
-    void simulate(SharpAllocator& alloc, matrix& demands);
+    // Lists every greedy tenant (positions below si) alongside the active ones
+    void next_quantum(DemandSource& source, SparseRow& demands, size_t si);
 
-    void output_sim(std::ostream& out, std::string label);
-};
\ No newline at end of file
+    SparseRow active_;
+
+    void finish(MetricAccumulator& metrics, uint64_t blocks, size_t si, bool valued);
+};
+
+template <typename A, typename Policy>
+void Simulation::simulate(A& alloc, DemandSource& demands) {
+    size_t si = sigma_ / 100.0 * N_;
+    std::vector<uint32_t> demand(N_), allocation(N_);
+    Policy policy(N_);
+
+    start(alloc, demands);
+    MetricAccumulator metrics(N_, si);
+
+    std::vector<bool> greedy(N_, false);
+    std::fill_n(greedy.begin(), si, true);
+
+    if constexpr (Policy::sparse) {
+        SparseRow sparse_demand, sparse_allocation;
+        for (uint32_t t = 0; t < T_; ++t) {
+            next_quantum(demands, sparse_demand, si);
+            alloc.set_sparse_demands(sparse_demand, greedy);
+
+            alloc.allocate();
+
+            alloc.get_sparse_allocations(sparse_allocation);
+            policy.record(alloc, metrics, sparse_demand, sparse_allocation);
+        }
+    } else {
+        for (uint32_t t = 0; t < T_; ++t) {
+            next_quantum(demands, demand);
+            alloc.set_demands(demand, greedy);
+
+            alloc.allocate();
+
+            alloc.get_allocations(allocation);
+            policy.record(alloc, metrics, demand, allocation);
+        }
+    }
+    finish(metrics, alloc.get_num_blocks(), si, Policy::valued);
+
+    proxy_alt_ = 0, proxy_selfish_ = 0;
+    if constexpr (Policy::has_proxy) {
+        proxy_.assign(N_, 0);
+        policy.finish(alloc, T_, proxy_);
+        proxy_alt_ = range_average(proxy_, si, N_);
+        proxy_selfish_ = range_average(proxy_, 0, si);
+        clamp(&proxy_alt_, &proxy_selfish_);
+    }
+}
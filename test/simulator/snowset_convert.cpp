@@ -0,0 +1,43 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "snowset.h"
+#include "trace.h"
+
+int main(int argc, char** argv) {
+    if (argc < 6 || argc > 9) {
+        std::cerr << "usage: snowset_csv trace_filename start end num_tenants [quantum] [seed] [tenant_column]"
+                  << std::endl;
+        return 0;
+    }
+
+    uint64_t start = std::strtoull(argv[3], nullptr, 10), end = std::strtoull(argv[4], nullptr, 10);
+    uint32_t N = std::atoi(argv[5]);
+    uint32_t quantum = argc > 6 ? std::atoi(argv[6]) : 1;
+    uint64_t seed = argc > 7 ? std::strtoull(argv[7], nullptr, 10) : 0;
+    std::string column = argc > 8 ? argv[8] : "warehouseId";
+
+    auto begin = std::chrono::steady_clock::now();
+    SnowsetLoader loader(argv[1], column);
+    uint64_t T = SnowsetLoader::get_num_quanta(start, end, quantum);
+
+    // Rows go straight to the writer, which is opened once the first row
+    // shows how many tenants were sampled
+    std::unique_ptr<DeltaTraceWriter> writer;
+    loader.bin(start, end, quantum, N, seed, std::thread::hardware_concurrency(),
+               [&](const std::vector<uint32_t>& row) {
+                   if (!writer) {
+                       writer = std::make_unique<DeltaTraceWriter>(argv[2], row.size(), T);
+                   }
+                   writer->append(row);
+               });
+    writer->close();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    DeltaTrace trace(argv[2]);
+    std::cout << "N=" << trace.get_num_tenants() << " T=" << trace.get_num_quanta()
+              << " queries=" << loader.get_num_queries() << " skipped=" << loader.get_num_skipped() << " in "
+              << secs << "s" << std::endl;
+}
@@ -0,0 +1,16 @@
+#include <iostream>
+
+#include "trace.h"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: demands_filename trace_filename" << std::endl;
+        return 0;
+    }
+
+    convert_text_trace(argv[1], argv[2]);
+
+    DemandTrace trace(argv[2]);
+    std::cout << "N=" << trace.get_num_tenants() << " T=" << trace.get_num_quanta()
+              << " width=" << trace.get_width() << std::endl;
+}